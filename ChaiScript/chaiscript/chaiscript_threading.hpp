@@ -12,7 +12,9 @@
 #define CHAISCRIPT_THREADING_HPP_
 
 
-#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 #ifndef CHAISCRIPT_NO_THREADS
 #include <thread>
@@ -61,13 +63,22 @@ namespace chaiscript
 
       using std::recursive_mutex;
 
-      /// Typesafe thread specific storage. If threading is enabled, this class uses a mutex protected map. If
+      /// Typesafe thread specific storage. If threading is enabled, each instance owns a slot index into
+      /// a thread local vector, so that reaching the data of the current thread is a couple of loads. If
       /// threading is not enabled, the class always returns the same data, regardless of which thread it is called from.
+      ///
+      /// Slot indices are reused once their instance is destroyed. Each slot also records the serial number
+      /// of the instance that filled it, so that a thread never sees data left behind by a previous owner of
+      /// its slot. Such data is released when the thread next uses the slot, or when it exits.
       template<typename T>
         class Thread_Storage
         {
           public:
-            Thread_Storage() = default;
+            Thread_Storage()
+              : m_slot(registry().acquire())
+            {
+            }
+
             Thread_Storage(const Thread_Storage &) = delete;
             Thread_Storage(Thread_Storage &&) = delete;
             Thread_Storage &operator=(const Thread_Storage &) = delete;
@@ -75,38 +86,116 @@ namespace chaiscript
 
             ~Thread_Storage()
             {
-              t().erase(this);
+              auto &slots = t();
+              if (m_slot.index < slots.size() && slots[m_slot.index].serial == m_slot.serial) {
+                slots[m_slot.index] = Slot_Data();
+              }
+              registry().release(m_slot.index);
             }
 
             inline const T *operator->() const
             {
-              return &(t()[this]);
+              return &get();
             }
 
             inline const T &operator*() const
             {
-              return t()[this];
+              return get();
             }
 
             inline T *operator->()
             {
-              return &(t()[this]);
+              return &get();
             }
 
             inline T &operator*()
             {
-              return t()[this];
+              return get();
             }
 
+          private:
+            struct Slot
+            {
+              std::size_t index;
+              std::uint_fast64_t serial;
+            };
 
-            void *m_key;
+            struct Slot_Data
+            {
+              std::uint_fast64_t serial = 0;
+              std::unique_ptr<T> obj;
+            };
 
-          private:
-            static std::unordered_map<const void*, T> &t()
+            /// Hands out slot indices, shared by all the instances for T
+            class Registry
+            {
+              public:
+                Slot acquire()
+                {
+                  lock_guard<mutex> l(m_mutex);
+                  Slot slot{m_next_index, ++m_serial};
+                  if (m_free.empty()) {
+                    ++m_next_index;
+                  } else {
+                    slot.index = m_free.back();
+                    m_free.pop_back();
+                  }
+                  return slot;
+                }
+
+                void release(const std::size_t t_index)
+                {
+                  lock_guard<mutex> l(m_mutex);
+                  m_free.push_back(t_index);
+                }
+
+              private:
+                mutex m_mutex;
+                std::vector<std::size_t> m_free;
+                std::size_t m_next_index = 0;
+                std::uint_fast64_t m_serial = 0;
+            };
+
+            T &get() const
             {
-              thread_local std::unordered_map<const void *, T> my_t;
+              auto &slots = t();
+              if (m_slot.index < slots.size() && slots[m_slot.index].serial == m_slot.serial) {
+                return *slots[m_slot.index].obj;
+              }
+
+              return create();
+            }
+
+            /// First access from this thread. T is constructed before the slot is looked up, in case
+            /// constructing it uses another Thread_Storage<T> and grows the vector.
+            T &create() const
+            {
+              auto obj = std::make_unique<T>();
+
+              auto &slots = t();
+              if (m_slot.index >= slots.size()) {
+                slots.resize(m_slot.index + 1);
+              }
+
+              auto &data = slots[m_slot.index];
+              data.serial = m_slot.serial;
+              std::swap(data.obj, obj);
+              return *data.obj;
+            }
+
+            static Registry &registry()
+            {
+              static Registry r;
+              return r;
+            }
+
+            static std::vector<Slot_Data> &t()
+            {
+              thread_local std::vector<Slot_Data> my_t;
               return my_t;
             }
+
+            const Slot m_slot;
         };
 
 #else // threading disabled
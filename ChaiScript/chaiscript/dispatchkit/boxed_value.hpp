@@ -11,8 +11,10 @@
 #ifndef CHAISCRIPT_BOXED_VALUE_HPP_
 #define CHAISCRIPT_BOXED_VALUE_HPP_
 
+#include <cstddef>
 #include <map>
 #include <memory>
+#include <new>
 #include <type_traits>
 
 #include "../chaiscript_defines.hpp"
@@ -21,6 +23,101 @@
 
 namespace chaiscript 
 {
+  namespace detail
+  {
+    /// Arithmetic value to be boxed as an immutable object, see const_var
+    template<typename T>
+      struct Const_Value
+      {
+        T value;
+      };
+
+    /// Allocator which keeps a small per thread cache of released single object blocks, for the
+    /// internal state of Boxed_Value objects, which are created and destroyed at a very high rate
+    template<typename T>
+      class Recycling_Allocator
+      {
+        public:
+          using value_type = T;
+
+          Recycling_Allocator() = default;
+
+          template<typename U>
+            Recycling_Allocator(const Recycling_Allocator<U> &) noexcept
+            {
+            }
+
+          T *allocate(std::size_t n)
+          {
+            auto &blocks = free_blocks();
+            if (n == 1 && blocks.count > 0) {
+              return static_cast<T *>(blocks.ptrs[--blocks.count]);
+            }
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+          }
+
+          void deallocate(T *p, std::size_t n) noexcept
+          {
+            auto &blocks = free_blocks();
+            if (n == 1 && !blocks.closed && blocks.count < Free_Blocks::capacity) {
+              blocks.ptrs[blocks.count++] = p;
+            } else {
+              ::operator delete(p);
+            }
+          }
+
+          template<typename U>
+            bool operator==(const Recycling_Allocator<U> &) const noexcept
+            {
+              return true;
+            }
+
+          template<typename U>
+            bool operator!=(const Recycling_Allocator<U> &) const noexcept
+            {
+              return false;
+            }
+
+        private:
+          /// Trivially destructible, so that it stays usable while the thread locals are torn down
+          struct Free_Blocks
+          {
+            static constexpr std::size_t capacity = 256;
+            void *ptrs[capacity];
+            std::size_t count;
+            bool closed;
+          };
+
+          /// Returns the cached blocks to the heap when the thread exits
+          struct Reaper
+          {
+            explicit Reaper(Free_Blocks &t_blocks) noexcept
+              : m_blocks(t_blocks)
+            {
+            }
+
+            ~Reaper()
+            {
+              m_blocks.closed = true;
+              while (m_blocks.count > 0) {
+                ::operator delete(m_blocks.ptrs[--m_blocks.count]);
+              }
+            }
+
+            Reaper(const Reaper &) = delete;
+            Reaper &operator=(const Reaper &) = delete;
+
+            Free_Blocks &m_blocks;
+          };
+
+          static Free_Blocks &free_blocks()
+          {
+            thread_local Free_Blocks blocks{};
+            thread_local Reaper reaper(blocks);
+            return blocks;
+          }
+      };
+  }
 
   /// \brief A wrapper for holding any valid C++ type. All types in ChaiScript are Boxed_Value objects
   /// \sa chaiscript::boxed_cast
@@ -34,7 +131,10 @@ namespace chaiscript
 
     private:
       /// structure which holds the internal state of a Boxed_Value
-      /// \todo Get rid of Any and merge it with this, reducing an allocation in the process
+      ///
+      /// Arithmetic values and bools are stored in place, in m_inline, rather than in a separately
+      /// allocated object owned by m_obj. They are only moved to the heap if someone asks for m_obj,
+      /// see detach().
       struct Data
       {
         Data(const Type_Info &ti,
@@ -47,6 +147,16 @@ namespace chaiscript
         {
         }
 
+        template<typename T>
+        Data(const Type_Info &ti, T t_value, bool t_return_value)
+          : m_type_info(ti), m_data_ptr(nullptr), m_const_data_ptr(nullptr), m_is_ref(false), m_return_value(t_return_value),
+            m_detach(ti.is_const()?&detach_inline<const T>:&detach_inline<T>)
+        {
+          static_assert(std::is_arithmetic<T>::value, "Only arithmetic values are stored in place");
+          static_assert(sizeof(T) <= sizeof(m_inline) && alignof(T) <= alignof(decltype(m_inline)), "Value does not fit in place");
+          set_ptrs(new (&m_inline) T(t_value));
+        }
+
         Data &operator=(const Data &rhs)
         {
           m_type_info = rhs.m_type_info;
@@ -55,6 +165,7 @@ namespace chaiscript
           m_data_ptr = rhs.m_data_ptr;
           m_const_data_ptr = rhs.m_const_data_ptr;
           m_return_value = rhs.m_return_value;
+          copy_inline(rhs);
 
           if (rhs.m_attrs)
           {
@@ -66,9 +177,34 @@ namespace chaiscript
 
         Data(const Data &) = delete;
 
-        Data(Data &&) = default;
-        Data &operator=(Data &&rhs) = default;
+        Data(Data &&rhs) noexcept
+          : m_type_info(rhs.m_type_info), m_obj(std::move(rhs.m_obj)), m_data_ptr(rhs.m_data_ptr), m_const_data_ptr(rhs.m_const_data_ptr),
+            m_attrs(std::move(rhs.m_attrs)), m_is_ref(rhs.m_is_ref), m_return_value(rhs.m_return_value)
+        {
+          copy_inline(rhs);
+        }
 
+        Data &operator=(Data &&rhs) noexcept
+        {
+          m_type_info = rhs.m_type_info;
+          m_obj = std::move(rhs.m_obj);
+          m_is_ref = rhs.m_is_ref;
+          m_data_ptr = rhs.m_data_ptr;
+          m_const_data_ptr = rhs.m_const_data_ptr;
+          m_return_value = rhs.m_return_value;
+          m_attrs = std::move(rhs.m_attrs);
+          copy_inline(rhs);
+          return *this;
+        }
+
+        /// Moves a value stored in place to a heap allocated object owned by m_obj, so that it can
+        /// be handed out as a std::shared_ptr or shared with another Data
+        void detach()
+        {
+          if (m_detach) {
+            m_detach(*this);
+          }
+        }
 
         Type_Info m_type_info;
         chaiscript::detail::Any m_obj;
@@ -77,13 +213,48 @@ namespace chaiscript
         std::unique_ptr<std::map<std::string, std::shared_ptr<Data>>> m_attrs;
         bool m_is_ref;
         bool m_return_value;
+
+      private:
+        template<typename T>
+        static void detach_inline(Data &t_data)
+        {
+          auto p = std::make_shared<T>(*static_cast<const T *>(t_data.m_const_data_ptr));
+          t_data.set_ptrs(p.get());
+          t_data.m_obj = chaiscript::detail::Any(std::move(p));
+          t_data.m_detach = nullptr;
+        }
+
+        void set_ptrs(const void *t_ptr) noexcept
+        {
+          m_data_ptr = m_type_info.is_const()?nullptr:const_cast<void *>(t_ptr);
+          m_const_data_ptr = t_ptr;
+        }
+
+        /// Copies the value rhs stores in place, if any, and points at the copy
+        void copy_inline(const Data &rhs) noexcept
+        {
+          m_detach = rhs.m_detach;
+          if (m_detach) {
+            m_inline = rhs.m_inline;
+            set_ptrs(&m_inline);
+          }
+        }
+
+        typename std::aligned_storage<sizeof(long double), alignof(long double)>::type m_inline;
+        void (*m_detach)(Data &) = nullptr;
       };
 
       struct Object_Data
       {
+        template<typename ... Param>
+          static std::shared_ptr<Data> make_data(Param && ... param)
+          {
+            return std::allocate_shared<Data>(chaiscript::detail::Recycling_Allocator<Data>(), std::forward<Param>(param)...);
+          }
+
         static auto get(Boxed_Value::Void_Type, bool t_return_value)
         {
-          return std::make_shared<Data>(
+          return make_data(
                 detail::Get_Type_Info<void>::get(),
                 chaiscript::detail::Any(), 
                 false,
@@ -101,7 +272,7 @@ namespace chaiscript
         template<typename T>
           static auto get(const std::shared_ptr<T> &obj, bool t_return_value)
           {
-            return std::make_shared<Data>(
+            return make_data(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(obj), 
                   false,
@@ -114,7 +285,7 @@ namespace chaiscript
           static auto get(std::shared_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return make_data(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(obj)), 
                   false,
@@ -142,7 +313,7 @@ namespace chaiscript
           static auto get(std::reference_wrapper<T> obj, bool t_return_value)
           {
             auto p = &obj.get();
-            return std::make_shared<Data>(
+            return make_data(
                   detail::Get_Type_Info<T>::get(),
                   chaiscript::detail::Any(std::move(obj)),
                   true,
@@ -155,7 +326,7 @@ namespace chaiscript
           static auto get(std::unique_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return make_data(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::make_shared<std::unique_ptr<T>>(std::move(obj))), 
                   true,
@@ -164,12 +335,30 @@ namespace chaiscript
                 );
           }
 
+        template<typename T>
+          static auto get(chaiscript::detail::Const_Value<T> t, bool t_return_value)
+          {
+            return make_data(detail::Get_Type_Info<const T>::get(), t.value, t_return_value);
+          }
+
         template<typename T>
           static auto get(T t, bool t_return_value)
+          {
+            return get_value(std::move(t), t_return_value, std::is_arithmetic<T>());
+          }
+
+        template<typename T>
+          static auto get_value(T t, bool t_return_value, std::true_type)
+          {
+            return make_data(detail::Get_Type_Info<T>::get(), t, t_return_value);
+          }
+
+        template<typename T>
+          static auto get_value(T t, bool t_return_value, std::false_type)
           {
             auto p = std::make_shared<T>(std::move(t));
             auto ptr = p.get();
-            return std::make_shared<Data>(
+            return make_data(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(p)),
                   false,
@@ -180,7 +369,7 @@ namespace chaiscript
 
         static std::shared_ptr<Data> get()
         {
-          return std::make_shared<Data>(
+          return make_data(
                 Type_Info(),
                 chaiscript::detail::Any(),
                 false,
@@ -217,6 +406,7 @@ namespace chaiscript
       /// m_data pointers are not shared in this case
       Boxed_Value assign(const Boxed_Value &rhs)
       {
+        rhs.m_data->detach();
         (*m_data) = (*rhs.m_data);
         return *this;
       }
@@ -283,8 +473,9 @@ namespace chaiscript
         return (m_data->m_data_ptr == nullptr && m_data->m_const_data_ptr == nullptr);
       }
 
-      const chaiscript::detail::Any & get() const noexcept
+      const chaiscript::detail::Any & get() const
       {
+        m_data->detach();
         return m_data->m_obj;
       }
 
@@ -390,14 +581,27 @@ namespace chaiscript
     }
 
   namespace detail {
-    /// \brief Takes a value, copies it and returns a Boxed_Value object that is immutable
+    template<typename T>
+      Boxed_Value const_var_impl(const T &t, std::false_type)
+      {
+        return Boxed_Value(std::make_shared<typename std::add_const<T>::type >(t));
+      }
+
+    template<typename T>
+      Boxed_Value const_var_impl(const T &t, std::true_type)
+      {
+        return Boxed_Value(Const_Value<T>{t});
+      }
+
+    /// \brief Takes a value, copies it and returns a Boxed_Value object that is immutable.
+    ///        Arithmetic values are stored in place, without a separate allocation.
     /// \param[in] t Value to copy and make const
     /// \returns Immutable Boxed_Value 
     /// \sa Boxed_Value::is_const
     template<typename T>
       Boxed_Value const_var_impl(const T &t)
       {
-        return Boxed_Value(std::make_shared<typename std::add_const<T>::type >(t));
+        return const_var_impl(t, std::is_arithmetic<T>());
       }
 
     /// \brief Takes a pointer to a value, adds const to the pointed to type and returns an immutable Boxed_Value.
@@ -12,6 +12,8 @@
 #define CHAISCRIPT_DISPATCHKIT_HPP_
 
 #include <algorithm>
+#include <array>
+#include <deque>
 #include <iostream>
 #include <list>
 #include <map>
@@ -272,7 +274,8 @@ namespace chaiscript
       public:
         explicit Dispatch_Function(std::vector<Proxy_Function> t_funcs)
           : Proxy_Function_Base(build_type_infos(t_funcs), calculate_arity(t_funcs)),
-            m_funcs(std::move(t_funcs))
+            m_funcs(std::move(t_funcs)),
+            m_has_guards(calculate_has_guards(m_funcs))
         {
         }
 
@@ -318,6 +321,18 @@ namespace chaiscript
                              [&vals, &t_conversions](const Proxy_Function &f){ return f->call_match(vals, t_conversions); });
         }
 
+        const std::vector<Proxy_Function> &get_functions() const
+        {
+          return m_funcs;
+        }
+
+        /// \returns true if any of the functions has a guard, making the dispatch depend on the
+        ///          values of the parameters and not only on their types
+        bool has_guards() const
+        {
+          return m_has_guards;
+        }
+
       protected:
         Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
         {
@@ -326,6 +341,16 @@ namespace chaiscript
 
       private:
         std::vector<Proxy_Function> m_funcs;
+        bool m_has_guards;
+
+        static bool calculate_has_guards(const std::vector<Proxy_Function> &t_funcs)
+        {
+          return std::any_of(t_funcs.begin(), t_funcs.end(),
+              [](const Proxy_Function &f) {
+                const auto dynamic_fun = std::dynamic_pointer_cast<const dispatch::Dynamic_Proxy_Function>(f);
+                return dynamic_fun && dynamic_fun->get_guard();
+              });
+        }
 
         static std::vector<Type_Info> build_type_infos(const std::vector<Proxy_Function> &t_funcs)
         {
@@ -380,9 +405,6 @@ namespace chaiscript
   {
     struct Stack_Holder
     {
-      //template <class T, std::size_t BufSize = sizeof(T)*20000>
-      //  using SmallVector = std::vector<T, short_alloc<T, BufSize>>;
-
       template <class T>
         using SmallVector = std::vector<T>;
       
@@ -401,35 +423,76 @@ namespace chaiscript
 
       void push_stack_data()
       {
-        stacks.back().emplace_back();
-//        stacks.back().emplace_back(Scope(scope_allocator));
+        stacks.back().push_back(take_spare(spare_scopes));
+      }
+
+      void pop_stack_data()
+      {
+        recycle(spare_scopes, stacks.back().back());
+        stacks.back().pop_back();
       }
 
       void push_stack()
       {
-        stacks.emplace_back(1);
-//        stacks.emplace_back(StackData(1, Scope(scope_allocator), stack_data_allocator));
+        stacks.push_back(take_spare(spare_stacks));
+        push_stack_data();
       }
 
-      void push_call_params()
+      void pop_stack()
       {
-        call_params.emplace_back();
-//        call_params.emplace_back(Call_Param_List(call_param_list_allocator));
+        for (auto &scope : stacks.back()) {
+          recycle(spare_scopes, scope);
+        }
+        recycle(spare_stacks, stacks.back());
+        stacks.pop_back();
       }
 
-      //Scope::allocator_type::arena_type scope_allocator;
-      //StackData::allocator_type::arena_type stack_data_allocator;
-      //Stacks::allocator_type::arena_type stacks_allocator;
-      //Call_Param_List::allocator_type::arena_type call_param_list_allocator;
-      //Call_Params::allocator_type::arena_type call_params_allocator;
+      void push_call_params()
+      {
+        call_params.push_back(take_spare(spare_call_params));
+      }
 
-//      Stacks stacks = Stacks(stacks_allocator);
-//      Call_Params call_params = Call_Params(call_params_allocator);
+      void pop_call_params()
+      {
+        recycle(spare_call_params, call_params.back());
+        call_params.pop_back();
+      }
 
       Stacks stacks;
       Call_Params call_params;
 
+      /// Frames popped on this thread, emptied but keeping their memory, so that pushing
+      /// scopes and calls does not allocate once the deepest nesting was reached.
+      /// Frames that outgrow them still grow as usual.
+      Stacks spare_stacks;
+      StackData spare_scopes;
+      Call_Params spare_call_params;
+
+      /// Register windows of the bytecode programs running on this thread, stacked by nested calls
+      std::deque<Boxed_Value> registers;
+      std::size_t registers_top = 0;
+
       int call_depth = 0;
+
+    private:
+      template<typename Container>
+        static Container take_spare(SmallVector<Container> &t_spares)
+        {
+          if (t_spares.empty()) {
+            return Container();
+          }
+
+          Container container(std::move(t_spares.back()));
+          t_spares.pop_back();
+          return container;
+        }
+
+      template<typename Container>
+        static void recycle(SmallVector<Container> &t_spares, Container &t_container)
+        {
+          t_container.clear();
+          t_spares.push_back(std::move(t_container));
+        }
     };
 
     /// Main class for the dispatchkit. Handles management
@@ -469,6 +532,7 @@ namespace chaiscript
         void add(const Type_Conversion &d)
         {
           m_conversions.add_conversion(d);
+          ++m_dispatch_generation;
         }
 
         /// Add a new named Proxy_Function to the system
@@ -557,11 +621,12 @@ namespace chaiscript
 
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          if (m_state.m_global_objects.find(name) != m_state.m_global_objects.end())
+          auto &globals = writable_state().m_global_objects;
+          if (globals.find(name) != globals.end())
           {
             throw chaiscript::exception::name_conflict_error(name);
           } else {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            globals.insert(std::make_pair(name, obj));
           }
         }
 
@@ -570,10 +635,10 @@ namespace chaiscript
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr == m_state.m_global_objects.end())
+          const auto itr = m_state->m_global_objects.find(name);
+          if (itr == m_state->m_global_objects.end())
           {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            writable_state().m_global_objects.insert(std::make_pair(name, obj));
             return obj;
           } else {
             return itr->second;
@@ -586,11 +651,12 @@ namespace chaiscript
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          if (m_state.m_global_objects.find(name) != m_state.m_global_objects.end())
+          auto &globals = writable_state().m_global_objects;
+          if (globals.find(name) != globals.end())
           {
             throw chaiscript::exception::name_conflict_error(name);
           } else {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            globals.insert(std::make_pair(name, obj));
           }
         }
 
@@ -599,12 +665,13 @@ namespace chaiscript
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr != m_state.m_global_objects.end())
+          const auto itr = m_state->m_global_objects.find(name);
+          if (itr != m_state->m_global_objects.end())
           {
+            // the object is shared by every snapshot, so it is updated in place
             itr->second.assign(obj);
           } else {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            writable_state().m_global_objects.insert(std::make_pair(name, obj));
           }
         }
 
@@ -630,12 +697,10 @@ namespace chaiscript
         /// Pops the current scope from the stack
         static void pop_scope(Stack_Holder &t_holder)
         {
-          t_holder.call_params.pop_back();
-          StackData &stack = get_stack_data(t_holder);
-
-          assert(!stack.empty());
+          assert(!get_stack_data(t_holder).empty());
 
-          stack.pop_back();
+          t_holder.pop_call_params();
+          t_holder.pop_stack_data();
         }
 
 
@@ -648,7 +713,22 @@ namespace chaiscript
 
         static void pop_stack(Stack_Holder &t_holder)
         {
-          t_holder.stacks.pop_back();
+          t_holder.pop_stack();
+        }
+
+        /// Returns the local object in the given slot of the given scope, counted from the bottom of the
+        /// current stack, if it has the given name. \sa optimizer::Resolve_Locals
+        static const Boxed_Value *get_local(const std::string &t_name, const std::size_t t_scope, const std::size_t t_slot, Stack_Holder &t_holder)
+        {
+          const auto &stack = get_stack_data(t_holder);
+          if (t_scope < stack.size()) {
+            const auto &scope = stack[t_scope];
+            if (t_slot < scope.size() && scope[t_slot].first == t_name) {
+              return &scope[t_slot].second;
+            }
+          }
+
+          return nullptr;
         }
 
         /// Searches the current stack for an object of the given name
@@ -687,21 +767,32 @@ namespace chaiscript
             t_loc = static_cast<uint_fast32_t>(Loc::located);
           } else if ((loc & static_cast<uint_fast32_t>(Loc::is_local)) != 0u) {
             auto &stack = get_stack_data(t_holder);
+            const auto depth = (loc & static_cast<uint_fast32_t>(Loc::stack_mask)) >> 16;
+            const auto slot = loc & static_cast<uint_fast32_t>(Loc::loc_mask);
+
+            if (depth < stack.size()) {
+              const auto &scope = stack[stack.size() - 1 - depth];
+              if (slot < scope.size() && scope[slot].first == name) {
+                return scope[slot].second;
+              }
+            }
 
-            return stack[stack.size() - 1 - ((loc & static_cast<uint_fast32_t>(Loc::stack_mask)) >> 16)][loc & static_cast<uint_fast32_t>(Loc::loc_mask)].second;
+            // the hint was recorded at another scope depth, or by another thread
+            t_loc = 0;
+            return get_object(name, t_loc, t_holder);
           }
 
           // Is the value we are looking for a global or function?
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          const auto &s = state();
 
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr != m_state.m_global_objects.end())
+          const auto itr = s.m_global_objects.find(name);
+          if (itr != s.m_global_objects.end())
           {
             return itr->second;
           }
 
           // no? is it a function object?
-          auto obj = get_function_object_int(name, loc);
+          auto obj = get_function_object_int(s, name, loc);
           if (obj.first != loc) { t_loc = uint_fast32_t(obj.first); }
 
           return obj.second;
@@ -715,17 +806,17 @@ namespace chaiscript
 
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          m_state.m_types.insert(std::make_pair(name, ti));
+          writable_state().m_types.insert(std::make_pair(name, ti));
         }
 
         /// Returns the type info for a named type
         Type_Info get_type(const std::string &name, bool t_throw = true) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          const auto &types = state().m_types;
 
-          const auto itr = m_state.m_types.find(name);
+          const auto itr = types.find(name);
 
-          if (itr != m_state.m_types.end())
+          if (itr != types.end())
           {
             return itr->second;
           }
@@ -742,9 +833,7 @@ namespace chaiscript
         /// match
         std::string get_type_name(const Type_Info &ti) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          for (const auto & elem : m_state.m_types)
+          for (const auto & elem : state().m_types)
           {
             if (elem.second.bare_equal(ti))
             {
@@ -758,9 +847,9 @@ namespace chaiscript
         /// Return all registered types
         std::vector<std::pair<std::string, Type_Info> > get_types() const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          const auto &types = state().m_types;
 
-          return std::vector<std::pair<std::string, Type_Info> >(m_state.m_types.begin(), m_state.m_types.end());
+          return std::vector<std::pair<std::string, Type_Info> >(types.begin(), types.end());
         }
 
         std::shared_ptr<std::vector<Proxy_Function>> get_method_missing_functions() const
@@ -778,9 +867,7 @@ namespace chaiscript
         /// Return a function by name
         std::pair<size_t, std::shared_ptr<std::vector< Proxy_Function>>> get_function(const std::string &t_name, const size_t t_hint) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto &funs = get_functions_int();
+          const auto &funs = get_functions_int(state());
 
           auto itr = find_keyed_value(funs, t_name, t_hint);
 
@@ -796,17 +883,15 @@ namespace chaiscript
         /// \throws std::range_error if it does not
         Boxed_Value get_function_object(const std::string &t_name) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          return get_function_object_int(t_name, 0).second;
+          return get_function_object_int(state(), t_name, 0).second;
         }
 
-        /// \returns a function object (Boxed_Value wrapper) if it exists
+        /// \returns a function object (Boxed_Value wrapper) of the given State if it exists
         /// \throws std::range_error if it does not
-        /// \warn does not obtain a mutex lock. \sa get_function_object for public version
-        std::pair<size_t, Boxed_Value> get_function_object_int(const std::string &t_name, const size_t t_hint) const
+        /// \sa get_function_object for public version
+        static std::pair<size_t, Boxed_Value> get_function_object_int(const State &t_state, const std::string &t_name, const size_t t_hint)
         {
-          const auto &funs = get_boxed_functions_int();
+          const auto &funs = get_boxed_functions_int(t_state);
 
           auto itr = find_keyed_value(funs, t_name, t_hint);
 
@@ -819,12 +904,17 @@ namespace chaiscript
         }
 
 
+        /// \returns A counter bumped whenever a function or a type conversion is added,
+        ///          invalidating what callers remembered of earlier dispatches
+        uint_fast32_t dispatch_generation() const
+        {
+          return m_dispatch_generation;
+        }
+
         /// Return true if a function exists
         bool function_exists(const std::string &name) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto &functions = get_functions_int();
+          const auto &functions = get_functions_int(state());
           return find_keyed_value(functions, name) != functions.end();
         }
 
@@ -882,8 +972,8 @@ namespace chaiscript
           }
 
           // add the global values
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-          retval.insert(m_state.m_global_objects.begin(), m_state.m_global_objects.end());
+          const auto &globals = state().m_global_objects;
+          retval.insert(globals.begin(), globals.end());
 
           return retval;
         }
@@ -894,9 +984,7 @@ namespace chaiscript
         ///
         std::map<std::string, Boxed_Value> get_function_objects() const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto &funs = get_function_objects_int();
+          const auto &funs = get_function_objects_int(state());
 
           std::map<std::string, Boxed_Value> objs;
 
@@ -912,11 +1000,9 @@ namespace chaiscript
         /// Get a vector of all registered functions
         std::vector<std::pair<std::string, Proxy_Function > > get_functions() const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
           std::vector<std::pair<std::string, Proxy_Function> > rets;
 
-          const auto &functions = get_functions_int();
+          const auto &functions = get_functions_int(state());
 
           for (const auto & function : functions)
           {
@@ -1186,32 +1272,34 @@ namespace chaiscript
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          return m_state;
+          return *m_state;
         }
 
         void set_state(const State &t_state)
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          m_state = t_state;
+          m_state = std::make_shared<State>(t_state);
+          ++m_state_generation;
+          ++m_dispatch_generation;
         }
 
         static void save_function_params(Stack_Holder &t_s, std::initializer_list<Boxed_Value> t_params)
         {
-          t_s.call_params.back().insert(t_s.call_params.back().begin(), t_params);
+          t_s.call_params.back().insert(t_s.call_params.back().end(), t_params);
         }
 
         static void save_function_params(Stack_Holder &t_s, std::vector<Boxed_Value> &&t_params)
         {
           for (auto &&param : t_params)
           {
-            t_s.call_params.back().insert(t_s.call_params.back().begin(), std::move(param));
+            t_s.call_params.back().push_back(std::move(param));
           }
         }
 
         static void save_function_params(Stack_Holder &t_s, const std::vector<Boxed_Value> &t_params)
         {
-          t_s.call_params.back().insert(t_s.call_params.back().begin(), t_params.begin(), t_params.end());
+          t_s.call_params.back().insert(t_s.call_params.back().end(), t_params.begin(), t_params.end());
         }
 
         void save_function_params(std::initializer_list<Boxed_Value> t_params)
@@ -1293,34 +1381,66 @@ namespace chaiscript
 
       private:
 
-        const std::vector<std::pair<std::string, Boxed_Value>> &get_boxed_functions_int() const
+        /// The State this thread last read, and the value of m_state_generation it was read at
+        struct State_Snapshot
         {
-          return m_state.m_boxed_functions;
+          std::shared_ptr<const State> m_state;
+          uint_fast32_t m_generation = 0;
+        };
+
+        /// \returns The current State. Readers do not lock unless the State changed since this thread
+        ///          last read it. The reference stays valid until this thread calls state() again.
+        const State &state() const
+        {
+          auto &snapshot = *m_state_snapshot;
+          if (!snapshot.m_state || snapshot.m_generation != m_state_generation.load(std::memory_order_acquire)) {
+            chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+            snapshot.m_state = m_state;
+            snapshot.m_generation = m_state_generation.load(std::memory_order_relaxed);
+          }
+          return *snapshot.m_state;
+        }
+
+        /// Copy on write access to the State for writers, who must hold m_mutex. Threads keep reading
+        /// the snapshot they hold, and pick up the new State on their next read. The copy is skipped
+        /// when no thread holds a snapshot of the current State, as is usual while registering.
+        State &writable_state()
+        {
+          if (m_state.use_count() != 1) {
+            m_state = std::make_shared<State>(*m_state);
+          }
+          m_state_generation.fetch_add(1, std::memory_order_release);
+          return *m_state;
+        }
+
+        static const std::vector<std::pair<std::string, Boxed_Value>> &get_boxed_functions_int(const State &t_state)
+        {
+          return t_state.m_boxed_functions;
         }
 
-        std::vector<std::pair<std::string, Boxed_Value>> &get_boxed_functions_int()
+        static std::vector<std::pair<std::string, Boxed_Value>> &get_boxed_functions_int(State &t_state)
         {
-          return m_state.m_boxed_functions;
+          return t_state.m_boxed_functions;
         }
 
-        const std::vector<std::pair<std::string, Proxy_Function>> &get_function_objects_int() const
+        static const std::vector<std::pair<std::string, Proxy_Function>> &get_function_objects_int(const State &t_state)
         {
-          return m_state.m_function_objects;
+          return t_state.m_function_objects;
         }
 
-        std::vector<std::pair<std::string, Proxy_Function>> &get_function_objects_int()
+        static std::vector<std::pair<std::string, Proxy_Function>> &get_function_objects_int(State &t_state)
         {
-          return m_state.m_function_objects;
+          return t_state.m_function_objects;
         }
 
-        const std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> &get_functions_int() const
+        static const std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> &get_functions_int(const State &t_state)
         {
-          return m_state.m_functions;
+          return t_state.m_functions;
         }
 
-        std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> &get_functions_int()
+        static std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> &get_functions_int(State &t_state)
         {
-          return m_state.m_functions;
+          return t_state.m_functions;
         }
 
         static bool function_less_than(const Proxy_Function &lhs, const Proxy_Function &rhs)
@@ -1458,7 +1578,8 @@ namespace chaiscript
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          auto &funcs = get_functions_int();
+          auto &s = writable_state();
+          auto &funcs = get_functions_int(s);
 
           auto itr = find_keyed_value(funcs, t_name);
 
@@ -1493,8 +1614,9 @@ namespace chaiscript
               }
             }();
 
-          add_keyed_value(get_boxed_functions_int(), t_name, const_var(new_func));
-          add_keyed_value(get_function_objects_int(), t_name, std::move(new_func));
+          add_keyed_value(get_boxed_functions_int(s), t_name, const_var(new_func));
+          add_keyed_value(get_function_objects_int(s), t_name, std::move(new_func));
+          ++m_dispatch_generation;
         }
 
         mutable chaiscript::detail::threading::shared_mutex m_mutex;
@@ -1505,8 +1627,148 @@ namespace chaiscript
         std::reference_wrapper<parser::ChaiScript_Parser_Base> m_parser;
 
         mutable std::atomic_uint_fast32_t m_method_missing_loc = {0};
+        std::atomic_uint_fast32_t m_dispatch_generation = {0};
+
+        std::shared_ptr<State> m_state = std::make_shared<State>();
+        std::atomic_uint_fast32_t m_state_generation = {0};
+        mutable chaiscript::detail::threading::Thread_Storage<State_Snapshot> m_state_snapshot;
+    };
+
+    /// Remembers, per thread, which function of an overload set a call site dispatched to for the
+    /// types of its parameters, so that later calls with the same types skip overload resolution.
+    /// Single functions are remembered too, to skip looking for an overload set. The entries are
+    /// dropped whenever functions or conversions are added to the engine, which is also the only
+    /// way overload sets come and go, so the entries need not keep them alive.
+    class Call_Site_Cache
+    {
+      public:
+        static const std::size_t max_entries = 4;
+
+        Boxed_Value call(const Dispatch_Engine &t_engine, const dispatch::Proxy_Function_Base &t_callee,
+            const std::vector<Boxed_Value> &t_params, const Type_Conversions_State &t_conversions) const
+        {
+          auto &cache = *m_cache;
+          const auto generation = t_engine.dispatch_generation();
+          if (cache.generation != generation) {
+            cache = Cache();
+            cache.generation = generation;
+          }
+
+          // the first entry is tried first, keeping monomorphic call sites cheapest
+          for (std::size_t i = 0; i < cache.size; ++i) {
+            const auto &entry = cache.entries[i];
+            if (entry.callee == &t_callee && matches(entry, t_params)) {
+              const auto selected = entry.selected;
+              if (selected == &t_callee) {
+                // a single function, nothing else to try
+                return t_callee(t_params, t_conversions);
+              }
+
+              try {
+                return (*selected)(t_params, t_conversions);
+              } catch (const chaiscript::exception::bad_boxed_cast &) {
+              } catch (const chaiscript::exception::arity_error &) {
+              } catch (const chaiscript::exception::guard_error &) {
+              }
+              // not decided by the types after all, resolve it the long way
+              remove(cache, selected);
+              break;
+            }
+          }
+
+          const auto dispatch_fun = dynamic_cast<const Dispatch_Function *>(&t_callee);
+          if (!dispatch_fun) {
+            auto retval = t_callee(t_params, t_conversions);
+            insert(*m_cache, t_engine, t_callee, t_callee, t_params);
+            return retval;
+          } else if (dispatch_fun->has_guards()) {
+            return t_callee(t_params, t_conversions);
+          }
+
+          const dispatch::Proxy_Function_Base *selected = nullptr;
+          auto retval = dispatch_fun->get_arity() < 0 || static_cast<std::size_t>(dispatch_fun->get_arity()) == t_params.size()
+            ? dispatch::dispatch(dispatch_fun->get_functions(), t_params, t_conversions, &selected)
+            : t_callee(t_params, t_conversions);
+          if (selected) {
+            insert(*m_cache, t_engine, t_callee, *selected, t_params);
+          }
+          return retval;
+        }
+
+      private:
+        struct Entry {
+          const dispatch::Proxy_Function_Base *callee = nullptr;
+          const dispatch::Proxy_Function_Base *selected = nullptr;
+          std::vector<Type_Info> param_types;
+        };
+
+        struct Cache {
+          uint_fast32_t generation = 0;
+          std::size_t size = 0;
+          std::size_t next = 0;
+          std::array<Entry, max_entries> entries;
+        };
+
+        static bool matches(const Entry &t_entry, const std::vector<Boxed_Value> &t_params)
+        {
+          if (t_entry.param_types.size() != t_params.size()) {
+            return false;
+          }
 
-        State m_state;
+          for (std::size_t i = 0; i < t_params.size(); ++i) {
+            const auto &ti = t_params[i].get_type_info();
+            const auto &cached = t_entry.param_types[i];
+            if (ti != cached || ti.is_const() != cached.is_const() || ti.is_reference() != cached.is_reference()
+                || ti.is_pointer() != cached.is_pointer()) {
+              return false;
+            }
+          }
+
+          return true;
+        }
+
+        /// The choice can be replayed for parameters of the same types, unless the types are
+        /// undefined or dynamic objects, whose methods are told apart by the names of their classes
+        static bool cacheable(const std::vector<Boxed_Value> &t_params)
+        {
+          return std::none_of(t_params.begin(), t_params.end(),
+              [](const Boxed_Value &bv) {
+                return bv.get_type_info().is_undef()
+                  || bv.get_type_info().bare_equal(user_type<dispatch::Dynamic_Object>());
+              });
+        }
+
+        static void insert(Cache &t_cache, const Dispatch_Engine &t_engine, const dispatch::Proxy_Function_Base &t_callee,
+            const dispatch::Proxy_Function_Base &t_selected, const std::vector<Boxed_Value> &t_params)
+        {
+          // the call may have added functions
+          if (t_cache.generation != t_engine.dispatch_generation() || !cacheable(t_params)) {
+            return;
+          }
+
+          // fill the table, then replace entries in turn
+          auto &entry = t_cache.size < max_entries ? t_cache.entries[t_cache.size++]
+                                                   : t_cache.entries[t_cache.next++ % max_entries];
+          entry.callee = &t_callee;
+          entry.selected = &t_selected;
+          entry.param_types.clear();
+          for (const auto &param : t_params) {
+            entry.param_types.push_back(param.get_type_info());
+          }
+        }
+
+        static void remove(Cache &t_cache, const dispatch::Proxy_Function_Base *t_selected)
+        {
+          for (std::size_t i = 0; i < t_cache.size; ++i) {
+            if (t_cache.entries[i].selected == t_selected) {
+              std::swap(t_cache.entries[i], t_cache.entries[--t_cache.size]);
+              t_cache.entries[t_cache.size] = Entry();
+              return;
+            }
+          }
+        }
+
+        mutable chaiscript::detail::threading::Thread_Storage<Cache> m_cache;
     };
 
     class Dispatch_State
@@ -1551,6 +1813,10 @@ namespace chaiscript
           return m_engine.get().get_object(t_name, t_loc, m_stack_holder.get());
         }
 
+        const Boxed_Value *get_local(const std::string &t_name, const std::size_t t_scope, const std::size_t t_slot) const {
+          return Dispatch_Engine::get_local(t_name, t_scope, t_slot, m_stack_holder.get());
+        }
+
       private:
         std::reference_wrapper<Dispatch_Engine> m_engine;
         std::reference_wrapper<Stack_Holder> m_stack_holder;
@@ -932,10 +932,15 @@ namespace chaiscript
     /// Take a vector of functions and a vector of parameters. Attempt to execute
     /// each function against the set of parameters, in order, until a matching
     /// function is found or throw dispatch_error if no matching function is found
+    /// \param[out] t_selected If given, set to the function that was executed, when it was found
+    ///                        without arithmetic conversions of the parameters, and to nullptr otherwise
     template<typename Funcs>
       Boxed_Value dispatch(const Funcs &funcs,
-          const std::vector<Boxed_Value> &plist, const Type_Conversions_State &t_conversions)
+          const std::vector<Boxed_Value> &plist, const Type_Conversions_State &t_conversions,
+          const Proxy_Function_Base **t_selected = nullptr)
       {
+        if (t_selected) { *t_selected = nullptr; }
+
         std::vector<std::pair<size_t, const Proxy_Function_Base *>> ordered_funcs;
         ordered_funcs.reserve(funcs.size());
 
@@ -967,7 +972,9 @@ namespace chaiscript
             try {
               if (func.first == i && (i == 0 || func.second->filter(plist, t_conversions)))
               {
-                return (*(func.second))(plist, t_conversions);
+                auto retval = (*(func.second))(plist, t_conversions);
+                if (t_selected) { *t_selected = func.second; }
+                return retval;
               }
             } catch (const exception::bad_boxed_cast &) {
               //parameter failed to cast, try again
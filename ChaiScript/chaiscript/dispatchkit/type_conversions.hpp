@@ -12,6 +12,8 @@
 #define CHAISCRIPT_DYNAMIC_CAST_CONVERSION_HPP_
 
 #include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
 #include <set>
 #include <stdexcept>
@@ -338,7 +340,7 @@ namespace chaiscript
         : m_mutex(),
           m_conversions(),
           m_convertableTypes(),
-          m_num_types(0)
+          m_generation(0)
       {
       }
 
@@ -350,14 +352,7 @@ namespace chaiscript
 
       const std::set<const std::type_info *, Less_Than> &thread_cache() const
       {
-        auto &cache = *m_thread_cache;
-        if (cache.size() != m_num_types)
-        {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-          cache = m_convertableTypes;
-        }
-
-        return cache;
+        return current_thread_cache().types;
       }
 
       void add_conversion(const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
@@ -366,7 +361,7 @@ namespace chaiscript
         /// \todo error if a conversion already exists
         m_conversions.insert(conversion);
         m_convertableTypes.insert({conversion->to().bare_type_info(), conversion->from().bare_type_info()});
-        m_num_types = m_convertableTypes.size();
+        ++m_generation;
       }
 
       template<typename T>
@@ -445,19 +440,16 @@ namespace chaiscript
 
       bool has_conversion(const Type_Info &to, const Type_Info &from) const
       {
-        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-        return find_bidir(to, from) != m_conversions.end();
+        return lookup(to, from).bidir_exists;
       }
 
       std::shared_ptr<detail::Type_Conversion_Base> get_conversion(const Type_Info &to, const Type_Info &from) const
       {
-        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-        const auto itr = find(to, from);
+        const auto &conversion = lookup(to, from).conversion;
 
-        if (itr != m_conversions.end())
+        if (conversion)
         {
-          return *itr;
+          return conversion;
         } else {
           throw std::out_of_range("No such conversion exists from " + from.bare_name() + " to " + to.bare_name());
         }
@@ -468,6 +460,74 @@ namespace chaiscript
       }
 
     private:
+      /// Result of looking for a conversion between two types, negative results included
+      struct Lookup
+      {
+        std::shared_ptr<detail::Type_Conversion_Base> conversion;
+        bool bidir_exists = false;
+      };
+
+      /// Orders (to, from) pairs of bare type_info addresses
+      struct Lookup_Less
+      {
+        typedef std::pair<const std::type_info *, const std::type_info *> key_type;
+
+        bool operator()(const key_type &t_lhs, const key_type &t_rhs) const
+        {
+          const std::less<const std::type_info *> less;
+          return less(t_lhs.first, t_rhs.first)
+            || (t_lhs.first == t_rhs.first && less(t_lhs.second, t_rhs.second));
+        }
+      };
+
+      /// What the current thread has learned of the conversions, as of m_generation
+      struct Thread_Cache
+      {
+        std::size_t generation = 0;
+        std::set<const std::type_info *, Less_Than> types;
+        std::map<Lookup_Less::key_type, Lookup, Lookup_Less> lookups;
+      };
+
+      Thread_Cache &current_thread_cache() const
+      {
+        auto &cache = *m_thread_cache;
+        const std::size_t generation = m_generation;
+        if (cache.generation != generation)
+        {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          cache.types = m_convertableTypes;
+          cache.lookups.clear();
+          cache.generation = m_generation;
+        }
+
+        return cache;
+      }
+
+      /// Searches the conversions for the pair of types once per thread, and remembers the answer
+      /// until the next add_conversion
+      const Lookup &lookup(const Type_Info &to, const Type_Info &from) const
+      {
+        auto &lookups = current_thread_cache().lookups;
+        const auto key = std::make_pair(to.bare_type_info(), from.bare_type_info());
+
+        const auto itr = lookups.find(key);
+        if (itr != lookups.end()) {
+          return itr->second;
+        }
+
+        Lookup result;
+        {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          const auto conversion = find(to, from);
+          if (conversion != m_conversions.end()) {
+            result.conversion = *conversion;
+          }
+          result.bidir_exists = find_bidir(to, from) != m_conversions.end();
+        }
+
+        return lookups.emplace(key, std::move(result)).first->second;
+      }
+
       std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find_bidir(
           const Type_Info &to, const Type_Info &from) const
       {
@@ -503,8 +563,8 @@ namespace chaiscript
       mutable chaiscript::detail::threading::shared_mutex m_mutex;
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> m_conversions;
       std::set<const std::type_info *, Less_Than> m_convertableTypes;
-      std::atomic_size_t m_num_types;
-      mutable chaiscript::detail::threading::Thread_Storage<std::set<const std::type_info *, Less_Than>> m_thread_cache;
+      std::atomic_size_t m_generation;
+      mutable chaiscript::detail::threading::Thread_Storage<Thread_Cache> m_thread_cache;
       mutable chaiscript::detail::threading::Thread_Storage<Conversion_Saves> m_conversion_saves;
   };
 
@@ -0,0 +1,643 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_BYTECODE_HPP_
+#define CHAISCRIPT_BYTECODE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "chaiscript_optimizer.hpp"
+
+namespace chaiscript {
+  /// \brief Lowering of optimized ASTs to a register based bytecode
+  ///
+  /// Function bodies, and loops at file scope, are compiled to a flat list of instructions working
+  /// on a window of registers, so that control flow, operands and temporaries no longer go through
+  /// the virtual eval of every node. Instructions keep the node they were lowered from and call its
+  /// operator helpers, so dispatch, conversions and the location caches of the nodes are shared with
+  /// the tree walking evaluator. Nodes without a lowering are evaluated by the tree walker in place.
+  namespace bytecode {
+
+    enum class Opcode : uint8_t {
+      Load_Constant,  ///< r[a] = constants[index]
+      Eval,           ///< r[a] = nodes[index] evaluated by the tree walker
+      Load_Object,    ///< r[a] = the object named by the Id node nodes[index]
+      Declare_Assign, ///< r[a] = r[b] declared by the Assign_Decl node nodes[index]
+      Assign,         ///< r[a] = r[b] assigned r[c] by the Equation node nodes[index]
+      Binary,         ///< r[a] = r[b] and r[c] combined by the Binary node nodes[index]
+      Binary_Right,   ///< r[a] = r[b] and the folded right hand side of the Binary node nodes[index]
+      Prefix,         ///< r[a] = r[b] applied to the Prefix node nodes[index]
+      Array_Call,     ///< r[a] = r[b][r[c]] by the Array_Call node nodes[index]
+      Call,           ///< r[a] = r[b] called with r[a+1] ... r[a+c] by the Fun_Call node nodes[index]
+      Call_Unused,    ///< as Call, for calls which do not need their parameters saved
+      To_Bool,        ///< r[a] = r[b] as a const bool
+      Jump,           ///< continues at index
+      Jump_If_False,  ///< continues at index if r[a] is false
+      Push_Scope,
+      Pop_Scope,
+      Return          ///< ends the program with r[a]
+    };
+
+    struct Instruction {
+      Opcode op;
+      uint16_t a;
+      uint16_t b;
+      uint16_t c;
+      uint32_t index;
+    };
+
+    /// Reserves registers on the register stack of the thread, and clears them when they go out of scope
+    class Register_Window {
+      public:
+        Register_Window(chaiscript::detail::Stack_Holder &t_holder, const std::size_t t_size)
+          : m_holder(t_holder),
+            m_base(t_holder.registers_top)
+        {
+          m_holder.registers_top += t_size;
+          if (m_holder.registers.size() < m_holder.registers_top) {
+            m_holder.registers.resize(m_holder.registers_top);
+          }
+        }
+
+        Register_Window(const Register_Window &) = delete;
+        Register_Window& operator=(const Register_Window &) = delete;
+
+        ~Register_Window()
+        {
+          // the deque never shrinks, so references held by outer windows stay valid
+          for (auto i = m_base; i < m_holder.registers_top; ++i) {
+            m_holder.registers[i] = void_var();
+          }
+          m_holder.registers_top = m_base;
+        }
+
+        Boxed_Value &operator[](const uint16_t t_register)
+        {
+          return m_holder.registers[m_base + t_register];
+        }
+
+      private:
+        chaiscript::detail::Stack_Holder &m_holder;
+        const std::size_t m_base;
+    };
+
+    template<typename T> class Compiler;
+
+    template<typename T>
+    class Program {
+      public:
+        Boxed_Value run(const chaiscript::detail::Dispatch_State &t_ss) const
+        {
+          Register_Window r(t_ss.stack_holder(), m_num_registers);
+          Open_Scopes scopes(t_ss);
+
+          std::size_t pc = 0;
+
+          try {
+            for (;;) {
+              const Instruction &i = m_code[pc++];
+
+              switch (i.op) {
+                case Opcode::Load_Constant:
+                  r[i.a] = m_constants[i.index];
+                  break;
+                case Opcode::Eval:
+                  r[i.a] = m_nodes[i.index]->eval(t_ss);
+                  break;
+                case Opcode::Load_Object:
+                  r[i.a] = node<eval::Id_AST_Node<T>>(i).eval_internal(t_ss);
+                  break;
+                case Opcode::Declare_Assign:
+                  r[i.a] = node<eval::Assign_Decl_AST_Node<T>>(i).declare(t_ss, r[i.b]);
+                  break;
+                case Opcode::Assign: {
+                  chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
+                  r[i.a] = node<eval::Equation_AST_Node<T>>(i).apply(t_ss, r[i.b], r[i.c]);
+                  break;
+                }
+                case Opcode::Binary:
+                  r[i.a] = node<eval::Binary_Operator_AST_Node<T>>(i).apply(t_ss, r[i.b], r[i.c]);
+                  break;
+                case Opcode::Binary_Right:
+                  r[i.a] = node<eval::Fold_Right_Binary_Operator_AST_Node<T>>(i).apply(t_ss, r[i.b]);
+                  break;
+                case Opcode::Prefix:
+                  r[i.a] = node<eval::Prefix_AST_Node<T>>(i).apply(t_ss, r[i.b]);
+                  break;
+                case Opcode::Array_Call: {
+                  chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
+                  r[i.a] = node<eval::Array_Call_AST_Node<T>>(i).apply(fpp, t_ss, {r[i.b], r[i.c]});
+                  break;
+                }
+                case Opcode::Call:
+                case Opcode::Call_Unused: {
+                  chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
+                  std::vector<Boxed_Value> params;
+                  params.reserve(i.c);
+                  for (uint16_t p = 1; p <= i.c; ++p) {
+                    params.push_back(r[static_cast<uint16_t>(i.a + p)]);
+                  }
+                  if (i.op == Opcode::Call) {
+                    fpp.save_params(params);
+                  }
+                  r[i.a] = node<eval::Fun_Call_AST_Node<T>>(i).do_call(t_ss, r[i.b], params);
+                  break;
+                }
+                case Opcode::To_Bool:
+                  r[i.a] = const_var(AST_Node::get_bool_condition(r[i.b], t_ss));
+                  break;
+                case Opcode::Jump:
+                  pc = i.index;
+                  break;
+                case Opcode::Jump_If_False:
+                  if (!AST_Node::get_bool_condition(r[i.a], t_ss)) {
+                    pc = i.index;
+                  }
+                  break;
+                case Opcode::Push_Scope:
+                  t_ss->new_scope(t_ss.stack_holder());
+                  ++scopes.count;
+                  break;
+                case Opcode::Pop_Scope:
+                  --scopes.count;
+                  t_ss->pop_scope(t_ss.stack_holder());
+                  break;
+                case Opcode::Return:
+                  return r[i.a];
+              }
+            }
+          } catch (exception::eval_error &ee) {
+            // the tree walker records each node an error goes through, lowered nodes have to do it here
+            const Instruction &i = m_code[pc - 1];
+            if (applies_node(i.op)) {
+              ee.call_stack.push_back(*m_nodes[i.index]);
+            }
+            throw;
+          }
+        }
+
+      private:
+        friend class Compiler<T>;
+
+        /// Pops the scopes left open by a return or an exception
+        struct Open_Scopes {
+          explicit Open_Scopes(const chaiscript::detail::Dispatch_State &t_ss)
+            : m_ss(t_ss)
+          {
+          }
+
+          ~Open_Scopes()
+          {
+            for (; count > 0; --count) {
+              m_ss->pop_scope(m_ss.stack_holder());
+            }
+          }
+
+          const chaiscript::detail::Dispatch_State &m_ss;
+          std::size_t count = 0;
+        };
+
+        static bool applies_node(const Opcode t_op)
+        {
+          switch (t_op) {
+            case Opcode::Load_Object:
+            case Opcode::Declare_Assign:
+            case Opcode::Assign:
+            case Opcode::Binary:
+            case Opcode::Binary_Right:
+            case Opcode::Prefix:
+            case Opcode::Array_Call:
+            case Opcode::Call:
+            case Opcode::Call_Unused:
+              return true;
+            default:
+              return false;
+          }
+        }
+
+        template<typename Node_Type>
+        const Node_Type &node(const Instruction &t_instruction) const
+        {
+          return static_cast<const Node_Type &>(*m_nodes[t_instruction.index]);
+        }
+
+        std::vector<Instruction> m_code;
+        std::vector<Boxed_Value> m_constants;
+        std::vector<const eval::AST_Node_Impl<T> *> m_nodes;
+        uint16_t m_num_registers = 1;
+    };
+
+    /// Lowers a tree to a Program. The nodes of the tree must outlive the program.
+    template<typename T>
+    class Compiler {
+      public:
+        /// Returns nullptr if the tree can not be lowered
+        static std::shared_ptr<const Program<T>> compile(const eval::AST_Node_Impl<T> &t_node, const bool t_function_body)
+        {
+          Compiler compiler(t_function_body);
+          try {
+            compiler.lower(t_node, 0);
+          } catch (const Unsupported &) {
+            return nullptr;
+          }
+          compiler.emit(Opcode::Return, 0);
+          return std::make_shared<const Program<T>>(std::move(compiler.m_program));
+        }
+
+      private:
+        typedef eval::AST_Node_Impl<T> Node;
+
+        struct Unsupported {};
+
+        struct Loop {
+          std::size_t scope_depth;
+          std::vector<std::size_t> breaks;
+          std::vector<std::size_t> continues;
+        };
+
+        explicit Compiler(const bool t_function_body)
+          : m_function_body(t_function_body)
+        {
+        }
+
+        /// Compiles the node leaving its value in t_dst, and using the registers after it as temporaries
+        void lower(const Node &t_node, const uint16_t t_dst)
+        {
+          switch (t_node.identifier) {
+            case AST_Node_Type::Constant:
+              if (const auto constant = dynamic_cast<const eval::Constant_AST_Node<T> *>(&t_node)) {
+                return load(constant->m_value, t_dst);
+              }
+              break;
+            case AST_Node_Type::Noop:
+              return load(void_var(), t_dst);
+            case AST_Node_Type::Id:
+              if (dynamic_cast<const eval::Id_AST_Node<T> *>(&t_node)) {
+                emit(Opcode::Load_Object, t_dst, 0, 0, node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Assign_Decl:
+              if (dynamic_cast<const eval::Assign_Decl_AST_Node<T> *>(&t_node)) {
+                lower(*t_node.children[1], t_dst);
+                emit(Opcode::Declare_Assign, t_dst, t_dst, 0, node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Equation:
+              if (dynamic_cast<const eval::Equation_AST_Node<T> *>(&t_node)) {
+                const auto lhs = next(t_dst);
+                lower(*t_node.children[1], t_dst);
+                lower(*t_node.children[0], lhs);
+                emit(Opcode::Assign, t_dst, lhs, t_dst, node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Binary:
+              if (dynamic_cast<const eval::Binary_Operator_AST_Node<T> *>(&t_node)) {
+                const auto rhs = next(t_dst);
+                lower(*t_node.children[0], t_dst);
+                lower(*t_node.children[1], rhs);
+                emit(Opcode::Binary, t_dst, t_dst, rhs, node_index(t_node));
+                return;
+              } else if (dynamic_cast<const eval::Fold_Right_Binary_Operator_AST_Node<T> *>(&t_node)) {
+                lower(*t_node.children[0], t_dst);
+                emit(Opcode::Binary_Right, t_dst, t_dst, 0, node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Prefix:
+              if (dynamic_cast<const eval::Prefix_AST_Node<T> *>(&t_node)) {
+                lower(*t_node.children[0], t_dst);
+                emit(Opcode::Prefix, t_dst, t_dst, 0, node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Array_Call:
+              if (dynamic_cast<const eval::Array_Call_AST_Node<T> *>(&t_node)) {
+                const auto index = next(t_dst);
+                lower(*t_node.children[0], t_dst);
+                lower(*t_node.children[1], index);
+                emit(Opcode::Array_Call, t_dst, t_dst, index, node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Fun_Call:
+              if (dynamic_cast<const eval::Inline_Fun_Call_AST_Node<T> *>(&t_node)) {
+                // Opcode::Call costs less than evaluating the inlined copy with the tree walker
+                return lower(*t_node.children[0], t_dst);
+              } else if (dynamic_cast<const eval::Fun_Call_AST_Node<T> *>(&t_node)
+                  && t_node.children.size() == 2
+                  && t_node.children[1]->identifier == AST_Node_Type::Arg_List) {
+                // parameters are evaluated before the function, as the tree walker does
+                const auto &params = t_node.children[1]->children;
+                uint16_t param = t_dst;
+                for (const auto &p : params) {
+                  param = next(param);
+                  lower(*p, param);
+                }
+                const auto fn = next(param);
+                lower(*t_node.children[0], fn);
+                const bool unused = dynamic_cast<const eval::Unused_Return_Fun_Call_AST_Node<T> *>(&t_node) != nullptr;
+                emit(unused ? Opcode::Call_Unused : Opcode::Call, t_dst, fn, static_cast<uint16_t>(params.size()),
+                    node_index(t_node));
+                return;
+              }
+              break;
+            case AST_Node_Type::Logical_And:
+            case AST_Node_Type::Logical_Or: {
+              lower(*t_node.children[0], t_dst);
+              emit(Opcode::To_Bool, t_dst, t_dst);
+              const auto short_circuit = emit(Opcode::Jump_If_False, t_dst);
+              if (t_node.identifier == AST_Node_Type::Logical_Or) {
+                const auto to_end = emit(Opcode::Jump);
+                patch(short_circuit);
+                lower(*t_node.children[1], t_dst);
+                emit(Opcode::To_Bool, t_dst, t_dst);
+                patch(to_end);
+              } else {
+                lower(*t_node.children[1], t_dst);
+                emit(Opcode::To_Bool, t_dst, t_dst);
+                patch(short_circuit);
+              }
+              return;
+            }
+            case AST_Node_Type::If: {
+              if (t_node.children.size() != 3) {
+                break;
+              }
+              lower(*t_node.children[0], t_dst);
+              const auto to_else = emit(Opcode::Jump_If_False, t_dst);
+              lower(*t_node.children[1], t_dst);
+              const auto to_end = emit(Opcode::Jump);
+              patch(to_else);
+              lower(*t_node.children[2], t_dst);
+              patch(to_end);
+              return;
+            }
+            case AST_Node_Type::Block:
+              push_scope();
+              statements(t_node, t_dst);
+              pop_scope();
+              return;
+            case AST_Node_Type::Scopeless_Block:
+              statements(t_node, t_dst);
+              return;
+            case AST_Node_Type::While: {
+              push_scope();
+              const auto begin = here();
+              condition(*t_node.children[0], t_dst);
+              const auto to_end = emit(Opcode::Jump_If_False, t_dst);
+              m_loops.push_back(Loop{m_scope_depth, {}, {}});
+              lower(*t_node.children[1], t_dst);
+              emit(Opcode::Jump, 0, 0, 0, begin);
+              end_loop(begin);
+              patch(to_end);
+              pop_scope();
+              return load(void_var(), t_dst);
+            }
+            case AST_Node_Type::For: {
+              push_scope();
+              lower(*t_node.children[0], t_dst);
+              const auto begin = here();
+              condition(*t_node.children[1], t_dst);
+              const auto to_end = emit(Opcode::Jump_If_False, t_dst);
+              m_loops.push_back(Loop{m_scope_depth, {}, {}});
+              lower(*t_node.children[3], t_dst);
+              const auto step = here();
+              lower(*t_node.children[2], t_dst);
+              emit(Opcode::Jump, 0, 0, 0, begin);
+              end_loop(step);
+              patch(to_end);
+              pop_scope();
+              return load(void_var(), t_dst);
+            }
+            case AST_Node_Type::Return:
+              if (m_function_body) {
+                if (t_node.children.empty()) {
+                  load(void_var(), t_dst);
+                } else {
+                  lower(*t_node.children[0], t_dst);
+                }
+                emit(Opcode::Return, t_dst);
+                return;
+              }
+              break;
+            case AST_Node_Type::Break:
+            case AST_Node_Type::Continue:
+              if (!m_loops.empty()) {
+                auto &loop = m_loops.back();
+                for (auto depth = m_scope_depth; depth > loop.scope_depth; --depth) {
+                  emit(Opcode::Pop_Scope);
+                }
+                (t_node.identifier == AST_Node_Type::Break ? loop.breaks : loop.continues).push_back(emit(Opcode::Jump));
+                return;
+              }
+              break;
+            default:
+              break;
+          }
+
+          // no lowering, evaluate the node with the tree walker
+          if (!m_loops.empty() && escapes_loop(t_node)) {
+            throw Unsupported();
+          }
+          emit(Opcode::Eval, t_dst, 0, 0, node_index(t_node));
+        }
+
+        void statements(const Node &t_node, const uint16_t t_dst)
+        {
+          if (t_node.children.empty()) {
+            return load(void_var(), t_dst);
+          }
+          for (const auto &child : t_node.children) {
+            lower(*child, t_dst);
+          }
+        }
+
+        /// Loop conditions only need their own scope if they declare something
+        void condition(const Node &t_node, const uint16_t t_dst)
+        {
+          const bool scoped = optimizer::contains_var_decl_in_scope(t_node);
+          if (scoped) {
+            push_scope();
+          }
+          lower(t_node, t_dst);
+          if (scoped) {
+            pop_scope();
+          }
+        }
+
+        void end_loop(const std::size_t t_continue_target)
+        {
+          for (const auto i : m_loops.back().continues) {
+            m_program.m_code[i].index = static_cast<uint32_t>(t_continue_target);
+          }
+          const auto breaks = std::move(m_loops.back().breaks);
+          m_loops.pop_back();
+          // breaks land where the condition exits, on the Pop_Scope of the loop
+          for (const auto i : breaks) {
+            m_program.m_code[i].index = static_cast<uint32_t>(here());
+          }
+        }
+
+        /// Whether evaluating the node can throw a break or a continue out of it
+        static bool escapes_loop(const Node &t_node, bool t_breaks = true)
+        {
+          switch (t_node.identifier) {
+            case AST_Node_Type::Break:
+              return t_breaks;
+            case AST_Node_Type::Continue:
+              return true;
+            case AST_Node_Type::While:
+            case AST_Node_Type::For:
+            case AST_Node_Type::Ranged_For:
+            case AST_Node_Type::Def:
+            case AST_Node_Type::Lambda:
+            case AST_Node_Type::Method:
+            case AST_Node_Type::Class:
+              return false;
+            case AST_Node_Type::Compiled:
+              return escapes_loop(*dynamic_cast<const eval::Compiled_AST_Node<T> &>(t_node).m_original_node, t_breaks);
+            case AST_Node_Type::Switch:
+              t_breaks = false;
+              break;
+            default:
+              break;
+          }
+
+          return std::any_of(t_node.children.begin(), t_node.children.end(),
+              [t_breaks](const auto &child) { return escapes_loop(*child, t_breaks); });
+        }
+
+        void load(const Boxed_Value &t_value, const uint16_t t_dst)
+        {
+          m_program.m_constants.push_back(t_value);
+          emit(Opcode::Load_Constant, t_dst, 0, 0, m_program.m_constants.size() - 1);
+        }
+
+        void push_scope()
+        {
+          emit(Opcode::Push_Scope);
+          ++m_scope_depth;
+        }
+
+        void pop_scope()
+        {
+          emit(Opcode::Pop_Scope);
+          --m_scope_depth;
+        }
+
+        uint16_t next(const uint16_t t_register)
+        {
+          if (t_register + 1 >= std::numeric_limits<uint16_t>::max()) {
+            throw Unsupported();
+          }
+          const auto retval = static_cast<uint16_t>(t_register + 1);
+          m_program.m_num_registers = std::max(m_program.m_num_registers, static_cast<uint16_t>(retval + 1));
+          return retval;
+        }
+
+        std::size_t node_index(const Node &t_node)
+        {
+          m_program.m_nodes.push_back(&t_node);
+          return m_program.m_nodes.size() - 1;
+        }
+
+        std::size_t here() const
+        {
+          return m_program.m_code.size();
+        }
+
+        std::size_t emit(const Opcode t_op, const uint16_t t_a = 0, const uint16_t t_b = 0, const uint16_t t_c = 0,
+            const std::size_t t_index = 0)
+        {
+          if (t_index > std::numeric_limits<uint32_t>::max()) {
+            throw Unsupported();
+          }
+          m_program.m_code.push_back(Instruction{t_op, t_a, t_b, t_c, static_cast<uint32_t>(t_index)});
+          return here() - 1;
+        }
+
+        /// Points a forward jump to the next instruction
+        void patch(const std::size_t t_jump)
+        {
+          m_program.m_code[t_jump].index = static_cast<uint32_t>(here());
+        }
+
+        Program<T> m_program;
+        std::vector<Loop> m_loops;
+        std::size_t m_scope_depth = 0;
+        const bool m_function_body;
+    };
+
+    /// Replaces the node with a compiled node running its program, if it can be lowered
+    template<typename T, typename Node_Ptr>
+      void compile_node(Node_Ptr &t_node, const bool t_function_body)
+      {
+        if (auto program = Compiler<T>::compile(*t_node, t_function_body)) {
+          std::shared_ptr<eval::AST_Node_Impl<T>> original(std::move(t_node));
+          t_node = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Compiled_AST_Node<T>>(std::move(original),
+              std::vector<eval::AST_Node_Impl_Ptr<T>>(),
+              [program](const std::vector<eval::AST_Node_Impl_Ptr<T>> &, const chaiscript::detail::Dispatch_State &t_ss) {
+                return program->run(t_ss);
+              });
+        }
+      }
+
+    /// Compiles the bodies of the functions defined in the tree
+    template<typename T>
+      void compile_functions(eval::AST_Node_Impl<T> &t_node)
+      {
+        for (auto &child : t_node.children) {
+          compile_functions(*child);
+        }
+
+        if (auto def = dynamic_cast<eval::Def_AST_Node<T> *>(&t_node)) {
+          compile_functions(*def->m_body_node);
+          compile_node<T>(def->m_body_node, true);
+        } else if (auto method = dynamic_cast<eval::Method_AST_Node<T> *>(&t_node)) {
+          compile_functions(*method->m_body_node);
+          compile_node<T>(method->m_body_node, true);
+        } else if (auto lambda = dynamic_cast<eval::Lambda_AST_Node<T> *>(&t_node)) {
+          compile_functions(*lambda->m_lambda_node);
+          compile_node<T>(lambda->m_lambda_node, true);
+        }
+      }
+  }
+
+  namespace optimizer {
+    /// Lowers function bodies and loops at file scope to bytecode once a file has been parsed.
+    /// It must be the last pass, as the other passes do not see through the compiled nodes.
+    struct Bytecode {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::File) {
+          bytecode::compile_functions(*node);
+
+          for (auto &child : node->children) {
+            if (child->identifier == AST_Node_Type::While || child->identifier == AST_Node_Type::For) {
+              bytecode::compile_node<T>(child, false);
+            }
+          }
+        }
+
+        return node;
+      }
+    };
+
+    typedef Optimizer<optimizer::Partial_Fold, optimizer::Unused_Return, optimizer::Constant_Fold, optimizer::Arithmetic,
+      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop, optimizer::Assign_Decl,
+      optimizer::Constant_Propagation, optimizer::Inline_Functions, optimizer::Loop_Invariant,
+      optimizer::Resolve_Locals, optimizer::Bytecode> Optimizer_Bytecode;
+  }
+}
+
+#endif /* CHAISCRIPT_BYTECODE_HPP_ */
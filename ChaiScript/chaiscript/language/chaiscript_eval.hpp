@@ -105,6 +105,119 @@ namespace chaiscript
           return incoming;
         }
       }
+
+      /// Operand types that have a specialized arithmetic path, see Arithmetic_Binary_Operator_AST_Node
+      enum class Arithmetic_Kind : unsigned char
+      {
+        generic, t_int, t_double, t_float
+      };
+
+      /// Cheap check of the exact type of an operand, which only compares type_info addresses. A type
+      /// whose type_info lives at another address is reported as generic, which is always safe.
+      inline Arithmetic_Kind arithmetic_kind(const Boxed_Value &t_bv) noexcept
+      {
+        const auto *ti = t_bv.get_type_info().bare_type_info();
+        if (ti == &typeid(int)) {
+          return Arithmetic_Kind::t_int;
+        } else if (ti == &typeid(double)) {
+          return Arithmetic_Kind::t_double;
+        } else if (ti == &typeid(float)) {
+          return Arithmetic_Kind::t_float;
+        } else {
+          return Arithmetic_Kind::generic;
+        }
+      }
+
+      /// Operators that arithmetic_go applies, the ones whose result is a new value
+      constexpr bool is_specialized_arithmetic(const Operators::Opers t_oper) noexcept
+      {
+        return (t_oper > Operators::Opers::boolean_flag && t_oper < Operators::Opers::non_const_flag)
+          || t_oper == Operators::Opers::remainder
+          || t_oper == Operators::Opers::sum
+          || t_oper == Operators::Opers::quotient
+          || t_oper == Operators::Opers::product
+          || t_oper == Operators::Opers::difference;
+      }
+
+      inline void check_divide_by_zero(const int t)
+      {
+#ifndef CHAISCRIPT_NO_PROTECT_DIVIDEBYZERO
+        if (t == 0) {
+          throw chaiscript::exception::arithmetic_error("divide by zero");
+        }
+#else
+        (void)t;
+#endif
+      }
+
+      template<typename N>
+      void check_divide_by_zero(const N)
+      {
+      }
+
+      inline Boxed_Value remainder_go(const int t, const int u)
+      {
+        check_divide_by_zero(u);
+        return const_var(t % u);
+      }
+
+      template<typename N>
+      Boxed_Value remainder_go(const N, const N)
+      {
+        throw chaiscript::detail::exception::bad_any_cast();
+      }
+
+      /// Same results as Boxed_Number::do_oper for two operands of type N, without its type dispatch
+      template<typename N>
+      Boxed_Value arithmetic_go(const Operators::Opers t_oper, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs)
+      {
+        const N t = *static_cast<const N *>(t_lhs.get_const_ptr());
+        const N u = *static_cast<const N *>(t_rhs.get_const_ptr());
+
+        switch (t_oper)
+        {
+          case Operators::Opers::sum:
+            return const_var(t + u);
+          case Operators::Opers::difference:
+            return const_var(t - u);
+          case Operators::Opers::product:
+            return const_var(t * u);
+          case Operators::Opers::quotient:
+            check_divide_by_zero(u);
+            return const_var(t / u);
+          case Operators::Opers::remainder:
+            return remainder_go(t, u);
+          case Operators::Opers::equals:
+            return const_var(t == u);
+          case Operators::Opers::less_than:
+            return const_var(t < u);
+          case Operators::Opers::greater_than:
+            return const_var(t > u);
+          case Operators::Opers::less_than_equal:
+            return const_var(t <= u);
+          case Operators::Opers::greater_than_equal:
+            return const_var(t >= u);
+          case Operators::Opers::not_equal:
+            return const_var(t != u);
+          default:
+            throw chaiscript::detail::exception::bad_any_cast();
+        }
+      }
+
+      inline Boxed_Value arithmetic_go(const Arithmetic_Kind t_kind, const Operators::Opers t_oper, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs)
+      {
+        switch (t_kind)
+        {
+          case Arithmetic_Kind::t_int:
+            return arithmetic_go<int>(t_oper, t_lhs, t_rhs);
+          case Arithmetic_Kind::t_double:
+            return arithmetic_go<double>(t_oper, t_lhs, t_rhs);
+          case Arithmetic_Kind::t_float:
+            return arithmetic_go<float>(t_oper, t_lhs, t_rhs);
+          default:
+            return Boxed_Number::do_oper(t_oper, t_lhs, t_rhs);
+        }
+      }
     }
 
     template<typename T>
@@ -156,7 +269,7 @@ namespace chaiscript
 
     template<typename T>
     struct Compiled_AST_Node : AST_Node_Impl<T> {
-        Compiled_AST_Node(AST_Node_Impl_Ptr<T> t_original_node, std::vector<AST_Node_Impl_Ptr<T>> t_children,
+        Compiled_AST_Node(std::shared_ptr<AST_Node_Impl<T>> t_original_node, std::vector<AST_Node_Impl_Ptr<T>> t_children,
             std::function<Boxed_Value (const std::vector<AST_Node_Impl_Ptr<T>> &, const chaiscript::detail::Dispatch_State &t_ss)> t_func) :
           AST_Node_Impl<T>(t_original_node->text, AST_Node_Type::Compiled, t_original_node->location, std::move(t_children)),
           m_func(std::move(t_func)),
@@ -168,7 +281,7 @@ namespace chaiscript
         }
 
         std::function<Boxed_Value (const std::vector<AST_Node_Impl_Ptr<T>> &, const chaiscript::detail::Dispatch_State &t_ss)> m_func;
-        AST_Node_Impl_Ptr<T> m_original_node;
+        std::shared_ptr<AST_Node_Impl<T>> m_original_node;
     };
 
 
@@ -181,19 +294,25 @@ namespace chaiscript
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
-          return do_oper(t_ss, this->text, this->children[0]->eval(t_ss));
+          return apply(t_ss, this->children[0]->eval(t_ss));
+        }
+
+        /// Applies the operator to an already evaluated left hand side
+        virtual Boxed_Value apply(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_lhs) const {
+          return do_oper(t_ss, this->text, t_lhs);
         }
 
       protected:
         Boxed_Value do_oper(const chaiscript::detail::Dispatch_State &t_ss, 
-            const std::string &t_oper_string, const Boxed_Value &t_lhs) const
+            const std::string &t_oper_string, const Boxed_Value &t_lhs,
+            const detail::Arithmetic_Kind t_kind = detail::Arithmetic_Kind::generic) const
         {
           try {
             if (t_lhs.get_type_info().is_arithmetic())
             {
               // If it's an arithmetic operation we want to short circuit dispatch
               try{
-                return Boxed_Number::do_oper(m_oper, t_lhs, m_rhs);
+                return detail::arithmetic_go(t_kind, m_oper, t_lhs, m_rhs);
               } catch (const chaiscript::exception::arithmetic_error &) {
                 throw;
               } catch (...) {
@@ -210,13 +329,34 @@ namespace chaiscript
           }
         }
 
-      private:
         Operators::Opers m_oper;
         Boxed_Value m_rhs;
+
+      private:
         mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
 
+    /// Fold_Right_Binary_Operator_AST_Node specialized for a constant right hand side of type int,
+    /// double or float, see optimizer::Arithmetic. The operator is applied directly while the left
+    /// hand side has the same type, and through Boxed_Number otherwise.
+    template<typename T>
+    struct Arithmetic_Fold_Right_Binary_Operator_AST_Node final : Fold_Right_Binary_Operator_AST_Node<T> {
+        Arithmetic_Fold_Right_Binary_Operator_AST_Node(const std::string &t_oper, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children, Boxed_Value t_rhs) :
+          Fold_Right_Binary_Operator_AST_Node<T>(t_oper, std::move(t_loc), std::move(t_children), std::move(t_rhs)),
+          m_kind(detail::arithmetic_kind(this->m_rhs))
+        { }
+
+        Boxed_Value apply(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_lhs) const override {
+          return this->do_oper(t_ss, this->text, t_lhs,
+              detail::arithmetic_kind(t_lhs) == m_kind ? m_kind : detail::Arithmetic_Kind::generic);
+        }
+
+      private:
+        detail::Arithmetic_Kind m_kind;
+    };
+
+
     template<typename T>
     struct Binary_Operator_AST_Node : AST_Node_Impl<T> {
         Binary_Operator_AST_Node(const std::string &t_oper, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
@@ -227,19 +367,25 @@ namespace chaiscript
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
           auto lhs = this->children[0]->eval(t_ss);
           auto rhs = this->children[1]->eval(t_ss);
-          return do_oper(t_ss, m_oper, this->text, lhs, rhs);
+          return apply(t_ss, lhs, rhs);
+        }
+
+        /// Applies the operator to already evaluated operands
+        virtual Boxed_Value apply(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs) const {
+          return do_oper(t_ss, m_oper, this->text, t_lhs, t_rhs);
         }
 
       protected:
         Boxed_Value do_oper(const chaiscript::detail::Dispatch_State &t_ss, 
-            Operators::Opers t_oper, const std::string &t_oper_string, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs) const
+            Operators::Opers t_oper, const std::string &t_oper_string, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs,
+            const detail::Arithmetic_Kind t_kind = detail::Arithmetic_Kind::generic) const
         {
           try {
             if (t_oper != Operators::Opers::invalid && t_lhs.get_type_info().is_arithmetic() && t_rhs.get_type_info().is_arithmetic())
             {
               // If it's an arithmetic operation we want to short circuit dispatch
               try{
-                return Boxed_Number::do_oper(t_oper, t_lhs, t_rhs);
+                return detail::arithmetic_go(t_kind, t_oper, t_lhs, t_rhs);
               } catch (const chaiscript::exception::arithmetic_error &) {
                 throw;
               } catch (...) {
@@ -256,12 +402,60 @@ namespace chaiscript
           }
         }
 
-      private:
         Operators::Opers m_oper;
+
+      private:
         mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
 
+    /// Binary_Operator_AST_Node installed by optimizer::Arithmetic for the operators in
+    /// detail::is_specialized_arithmetic. It speculates that both operands are int, double or float
+    /// of the same type, which it checks on every evaluation, and falls back to Boxed_Number when
+    /// they are not.
+    template<typename T>
+    struct Arithmetic_Binary_Operator_AST_Node final : Binary_Operator_AST_Node<T> {
+        using Binary_Operator_AST_Node<T>::Binary_Operator_AST_Node;
+
+        Boxed_Value apply(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs) const override {
+          const auto kind = detail::arithmetic_kind(t_lhs);
+          return this->do_oper(t_ss, this->m_oper, this->text, t_lhs, t_rhs,
+              detail::arithmetic_kind(t_rhs) == kind ? kind : detail::Arithmetic_Kind::generic);
+        }
+    };
+
+
+    /// An expression whose value does not change while a loop runs, see optimizer::Loop_Invariant.
+    /// children[0] names the local, declared just before the loop, that keeps the value, and
+    /// children[1] is the expression. It is evaluated the first time it is reached, and kept
+    /// only if its operands are arithmetic, as operators on other types may have side effects.
+    template<typename T>
+    struct Loop_Invariant_AST_Node final : AST_Node_Impl<T> {
+        Loop_Invariant_AST_Node(std::string t_ast_node_text, AST_Node_Type t_id, Parse_Location t_loc,
+            std::vector<AST_Node_Impl_Ptr<T>> t_children, std::vector<const AST_Node_Impl<T> *> t_operands) :
+          AST_Node_Impl<T>(std::move(t_ast_node_text), t_id, std::move(t_loc), std::move(t_children)),
+          m_operands(std::move(t_operands))
+        { assert(this->children.size() == 2); }
+
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
+          Boxed_Value saved = this->children[0]->eval(t_ss);
+          if (!saved.is_undef()) {
+            return saved;
+          }
+
+          Boxed_Value value = this->children[1]->eval(t_ss);
+          if (std::all_of(m_operands.begin(), m_operands.end(),
+                [&t_ss](const AST_Node_Impl<T> *t_operand) { return t_operand->eval(t_ss).get_type_info().is_arithmetic(); })) {
+            saved.assign(value);
+          }
+          return value;
+        }
+
+      private:
+        std::vector<const AST_Node_Impl<T> *> m_operands;
+    };
+
+
     template<typename T>
     struct Constant_AST_Node final : AST_Node_Impl<T> {
       Constant_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, Boxed_Value t_value)
@@ -290,6 +484,12 @@ namespace chaiscript
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
+          if (m_scope != unresolved) {
+            if (const auto *obj = t_ss.get_local(this->text, m_scope, m_slot)) {
+              return *obj;
+            }
+          }
+
           try {
             return t_ss.get_object(this->text, m_loc);
           }
@@ -298,8 +498,19 @@ namespace chaiscript
           }
         }
 
+        /// Looks the object up in the given slot of the given scope of the function's stack first,
+        /// as found by optimizer::Resolve_Locals
+        void resolve(const std::size_t t_scope, const std::size_t t_slot) {
+          m_scope = t_scope;
+          m_slot = t_slot;
+        }
+
       private:
+        static const std::size_t unresolved = std::numeric_limits<std::size_t>::max();
+
         mutable std::atomic_uint_fast32_t m_loc = {0};
+        std::size_t m_scope = unresolved;
+        std::size_t m_slot = 0;
     };
 
     template<typename T>
@@ -327,9 +538,16 @@ namespace chaiscript
 
           Boxed_Value fn(this->children[0]->eval(t_ss));
 
+          return do_call(t_ss, fn, params);
+        }
+
+        /// Calls an already evaluated function with already evaluated parameters
+        /// \warning The caller is expected to hold a Function_Push_Pop
+        Boxed_Value do_call(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &fn, const std::vector<Boxed_Value> &params) const
+        {
           using ConstFunctionTypePtr = const dispatch::Proxy_Function_Base *;
           try {
-            return (*t_ss->boxed_cast<ConstFunctionTypePtr>(fn))(params, t_ss.conversions());
+            return m_cache.call(*t_ss, *t_ss->boxed_cast<ConstFunctionTypePtr>(fn), params, t_ss.conversions());
           }
           catch(const exception::dispatch_error &e){
             throw exception::eval_error(std::string(e.what()) + " with function '" + this->children[0]->text + "'", e.parameters, e.functions, false, *t_ss);
@@ -360,6 +578,8 @@ namespace chaiscript
           return do_eval_internal<true>(t_ss);
         }
 
+      private:
+        chaiscript::detail::Call_Site_Cache m_cache;
     };
 
 
@@ -375,6 +595,43 @@ namespace chaiscript
     };
 
 
+    /// A call to a function defined by the script, with a copy of the function's body where the arguments
+    /// stand for the parameters, see optimizer::Inline_Functions. The copy is evaluated in place of the call
+    /// while the callee still names that very function, and the original call is made otherwise.
+    template<typename T>
+    struct Inline_Fun_Call_AST_Node final : AST_Node_Impl<T> {
+        Inline_Fun_Call_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children,
+            const AST_Node *t_body) :
+          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Fun_Call, std::move(t_loc), std::move(t_children)),
+          m_body(t_body)
+        { assert(this->children.size() == 2); }
+
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override
+        {
+          if (calls_inlined_function(t_ss)) {
+            return this->children[1]->eval(t_ss);
+          } else {
+            return this->children[0]->eval(t_ss);
+          }
+        }
+
+      private:
+        bool calls_inlined_function(const chaiscript::detail::Dispatch_State &t_ss) const
+        {
+          try {
+            const auto fun = dynamic_cast<const dispatch::Dynamic_Proxy_Function *>(
+                boxed_cast<const dispatch::Proxy_Function_Base *>(this->children[0]->children[0]->eval(t_ss)));
+            return fun && fun->has_parse_tree() && &fun->get_parse_tree() == m_body;
+          } catch (const std::exception &) {
+            // let the call report the error
+            return false;
+          }
+        }
+
+        const AST_Node *m_body;
+    };
+
+
 
 
 
@@ -448,6 +705,12 @@ namespace chaiscript
           Boxed_Value rhs = this->children[1]->eval(t_ss); 
           Boxed_Value lhs = this->children[0]->eval(t_ss);
 
+          return apply(t_ss, std::move(lhs), std::move(rhs));
+        }
+
+        /// Assigns already evaluated operands
+        /// \warning The caller is expected to hold a Function_Push_Pop
+        Boxed_Value apply(const chaiscript::detail::Dispatch_State &t_ss, Boxed_Value lhs, Boxed_Value rhs) const {
           if (lhs.is_return_value()) {
             throw exception::eval_error("Error, cannot assign to temporary value.");
           } else if (lhs.is_const()) {
@@ -566,10 +829,15 @@ namespace chaiscript
           AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Assign_Decl, std::move(t_loc), std::move(t_children)) { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
+          return declare(t_ss, this->children[1]->eval(t_ss));
+        }
+
+        /// Declares the variable with an already evaluated initial value
+        Boxed_Value declare(const chaiscript::detail::Dispatch_State &t_ss, Boxed_Value t_value) const {
           const std::string &idname = this->children[0]->text;
 
           try {
-            Boxed_Value bv(detail::clone_if_necessary(this->children[1]->eval(t_ss), m_loc, t_ss));
+            Boxed_Value bv(detail::clone_if_necessary(std::move(t_value), m_loc, t_ss));
             bv.reset_return_value();
             t_ss.add_object(idname, bv);
             return bv;
@@ -592,6 +860,12 @@ namespace chaiscript
 
           const std::vector<Boxed_Value> params{this->children[0]->eval(t_ss), this->children[1]->eval(t_ss)};
 
+          return apply(fpp, t_ss, params);
+        }
+
+        /// Looks up an already evaluated index in an already evaluated container
+        Boxed_Value apply(chaiscript::eval::detail::Function_Push_Pop &fpp, const chaiscript::detail::Dispatch_State &t_ss,
+            const std::vector<Boxed_Value> &params) const {
           try {
             fpp.save_params(params);
             return t_ss->call_function("[]", m_loc, params, t_ss.conversions());
@@ -717,7 +991,9 @@ namespace chaiscript
       private:
         const std::vector<std::string> m_param_names;
         const bool m_this_capture = false;
-        const std::shared_ptr<AST_Node_Impl<T>> m_lambda_node;
+
+      public:
+        std::shared_ptr<AST_Node_Impl<T>> m_lambda_node;
     };
 
     template<typename T>
@@ -1203,8 +1479,11 @@ namespace chaiscript
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
-          Boxed_Value bv(this->children[0]->eval(t_ss));
+          return apply(t_ss, this->children[0]->eval(t_ss));
+        }
 
+        /// Applies the operator to an already evaluated operand
+        Boxed_Value apply(const chaiscript::detail::Dispatch_State &t_ss, Boxed_Value bv) const {
           try {
             // short circuit arithmetic operations
             if (m_oper != Operators::Opers::invalid && m_oper != Operators::Opers::bitwise_and && bv.get_type_info().is_arithmetic())
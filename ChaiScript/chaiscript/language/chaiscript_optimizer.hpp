@@ -7,6 +7,8 @@
 #ifndef CHAISCRIPT_OPTIMIZER_HPP_
 #define CHAISCRIPT_OPTIMIZER_HPP_
 
+#include <set>
+
 #include "chaiscript_eval.hpp"
 
 
@@ -380,6 +382,34 @@ namespace chaiscript {
       }
     };
 
+    /// Replaces binary operators that have a specialized path for int, double and float operands,
+    /// see eval::Arithmetic_Binary_Operator_AST_Node. Runs after Partial_Fold and Constant_Fold.
+    struct Arithmetic {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::Binary
+            && node->children.size() == 2
+            && eval::detail::is_specialized_arithmetic(Operators::to_operator(node->text)))
+        {
+          if (dynamic_cast<eval::Arithmetic_Binary_Operator_AST_Node<T> *>(node.get())
+              || dynamic_cast<eval::Arithmetic_Fold_Right_Binary_Operator_AST_Node<T> *>(node.get())) {
+            return node;
+          } else if (dynamic_cast<eval::Fold_Right_Binary_Operator_AST_Node<T> *>(node.get())) {
+            const auto rhs = dynamic_cast<const eval::Constant_AST_Node<T> &>(*node->children[1]).m_value;
+            if (eval::detail::arithmetic_kind(rhs) != eval::detail::Arithmetic_Kind::generic) {
+              return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Arithmetic_Fold_Right_Binary_Operator_AST_Node<T>>(node->text, node->location,
+                  std::move(node->children), rhs);
+            }
+          } else if (dynamic_cast<eval::Binary_Operator_AST_Node<T> *>(node.get())) {
+            return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Arithmetic_Binary_Operator_AST_Node<T>>(node->text, node->location,
+                std::move(node->children));
+          }
+        }
+
+        return node;
+      }
+    };
+
     struct For_Loop {
       template<typename T>
       auto optimize(eval::AST_Node_Impl_Ptr<T> for_node) {
@@ -461,8 +491,1197 @@ namespace chaiscript {
       }
     };
 
-    typedef Optimizer<optimizer::Partial_Fold, optimizer::Unused_Return, optimizer::Constant_Fold, 
-      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop, optimizer::Assign_Decl> Optimizer_Default; 
+    /// Finds, for the Id nodes of function bodies, the scope and the slot of the local object they name,
+    /// by replaying the scopes the nodes push and the objects they declare when evaluated. Scopes are
+    /// counted from the bottom of the function's stack, so they do not depend on where the function is
+    /// called from. Id nodes still check the name found there, and search for it as before when a
+    /// declaration was skipped at runtime. Functions calling eval, whose declarations can't be known,
+    /// are left alone, as is code outside of functions.
+    template<typename T>
+    class Local_Resolver
+    {
+      public:
+        /// Resolves the locals of all functions defined in t_node
+        static void resolve_functions(eval::AST_Node_Impl<T> &t_node)
+        {
+          Local_Resolver resolver(false, {});
+          resolver.visit(t_node);
+        }
+
+      private:
+        Local_Resolver(const bool t_active, std::vector<std::string> t_locals)
+          : m_active(t_active), m_scopes(1, std::move(t_locals))
+        {
+        }
+
+        static void resolve_function(eval::AST_Node_Impl<T> &t_body, std::vector<std::string> t_locals)
+        {
+          Local_Resolver resolver(true, std::move(t_locals));
+          resolver.visit(t_body);
+
+          if (!resolver.m_dynamic) {
+            for (const auto &resolved : resolver.m_resolved) {
+              std::get<0>(resolved)->resolve(std::get<1>(resolved), std::get<2>(resolved));
+            }
+          }
+        }
+
+        /// The objects eval_function declares before evaluating a function body, in order
+        static std::vector<std::string> function_locals(const std::vector<std::string> &t_param_names,
+            std::vector<std::string> t_captures = {}, const bool t_this_capture = false)
+        {
+          std::vector<std::string> locals;
+
+          // without parameters "this" is only declared when called as a method, the check of the name
+          // in Id_AST_Node covers that case
+          if (!t_param_names.empty() && !t_this_capture) {
+            locals.emplace_back("this");
+          }
+
+          // captures are passed in a map
+          std::sort(t_captures.begin(), t_captures.end());
+          t_captures.erase(std::unique(t_captures.begin(), t_captures.end()), t_captures.end());
+          locals.insert(locals.end(), t_captures.begin(), t_captures.end());
+
+          for (const auto &name : t_param_names) {
+            if (name != "this") {
+              locals.push_back(name);
+            }
+          }
+
+          return locals;
+        }
+
+        void push_scope()
+        {
+          m_scopes.emplace_back();
+        }
+
+        void pop_scope()
+        {
+          m_scopes.pop_back();
+        }
+
+        void declare(const std::string &t_name)
+        {
+          m_scopes.back().push_back(t_name);
+        }
+
+        void lookup(eval::AST_Node_Impl<T> &t_node)
+        {
+          if (!m_active) {
+            return;
+          }
+
+          for (auto scope = m_scopes.size(); scope-- > 0;) {
+            const auto &names = m_scopes[scope];
+            const auto itr = std::find(names.begin(), names.end(), t_node.text);
+            if (itr != names.end()) {
+              m_resolved.emplace_back(&dynamic_cast<eval::Id_AST_Node<T> &>(t_node), scope, static_cast<std::size_t>(std::distance(names.begin(), itr)));
+              return;
+            }
+          }
+        }
+
+        void visit_children(eval::AST_Node_Impl<T> &t_node, const std::size_t t_begin = 0)
+        {
+          for (auto i = t_begin; i < t_node.children.size(); ++i) {
+            visit(*t_node.children[i]);
+          }
+        }
+
+        void visit(eval::AST_Node_Impl<T> &t_node)
+        {
+          switch (t_node.identifier) {
+            case AST_Node_Type::Id:
+              lookup(t_node);
+              break;
+            case AST_Node_Type::Var_Decl:
+            case AST_Node_Type::Reference:
+              declare(t_node.children[0]->text);
+              break;
+            case AST_Node_Type::Assign_Decl:
+              visit(*t_node.children[1]);
+              declare(t_node.children[0]->text);
+              break;
+            case AST_Node_Type::Equation:
+              visit(*t_node.children[1]);
+              visit(*t_node.children[0]);
+              break;
+            case AST_Node_Type::Global_Decl:
+            case AST_Node_Type::Attr_Decl:
+            case AST_Node_Type::Constant:
+              break;
+            case AST_Node_Type::Fun_Call:
+            case AST_Node_Type::Unused_Return_Fun_Call: {
+              const auto &fun = *t_node.children[0];
+              if (fun.identifier == AST_Node_Type::Id
+                  && (fun.text == "eval" || fun.text == "eval_file" || fun.text == "use")) {
+                m_dynamic = true;
+              }
+              visit_children(t_node);
+              break;
+            }
+            case AST_Node_Type::Dot_Access:
+              visit(*t_node.children[0]);
+              if (t_node.children[1]->children.size() > 1) {
+                visit(*t_node.children[1]->children[1]);
+              }
+              break;
+            case AST_Node_Type::Block:
+            case AST_Node_Type::Case:
+            case AST_Node_Type::Default:
+              push_scope();
+              visit_children(t_node, t_node.identifier == AST_Node_Type::Case ? 1 : 0);
+              pop_scope();
+              break;
+            case AST_Node_Type::While:
+              push_scope();
+              push_scope();
+              visit(*t_node.children[0]);
+              pop_scope();
+              visit(*t_node.children[1]);
+              pop_scope();
+              break;
+            case AST_Node_Type::For:
+              push_scope();
+              visit(*t_node.children[0]);
+              push_scope();
+              visit(*t_node.children[1]);
+              pop_scope();
+              visit(*t_node.children[3]);
+              visit(*t_node.children[2]);
+              pop_scope();
+              break;
+            case AST_Node_Type::Ranged_For:
+              visit(*t_node.children[1]);
+              push_scope();
+              declare(t_node.children[0]->text);
+              visit(*t_node.children[2]);
+              pop_scope();
+              break;
+            case AST_Node_Type::Switch:
+              push_scope();
+              visit(*t_node.children[0]);
+              for (std::size_t i = 1; i < t_node.children.size(); ++i) {
+                if (t_node.children[i]->identifier == AST_Node_Type::Case) {
+                  visit(*t_node.children[i]->children[0]);
+                }
+                visit(*t_node.children[i]);
+              }
+              pop_scope();
+              break;
+            case AST_Node_Type::Try:
+              push_scope();
+              visit(*t_node.children[0]);
+              for (std::size_t i = 1; i < t_node.children.size(); ++i) {
+                auto &handler = *t_node.children[i];
+                if (handler.identifier == AST_Node_Type::Finally) {
+                  visit_children(handler);
+                } else {
+                  push_scope();
+                  if (handler.children.size() > 1) {
+                    declare(eval::Arg_List_AST_Node<T>::get_arg_name(*handler.children[0]));
+                    visit_children(handler, 1);
+                  } else {
+                    visit_children(handler);
+                  }
+                  pop_scope();
+                }
+              }
+              pop_scope();
+              break;
+            case AST_Node_Type::Class:
+              push_scope();
+              declare("_current_class_name");
+              visit(*t_node.children[1]);
+              pop_scope();
+              break;
+            case AST_Node_Type::Def: {
+              auto &def = dynamic_cast<eval::Def_AST_Node<T> &>(t_node);
+              const auto param_names = (def.children.size() > 1 && def.children[1]->identifier == AST_Node_Type::Arg_List)
+                ? eval::Arg_List_AST_Node<T>::get_arg_names(*def.children[1]) : std::vector<std::string>();
+              resolve_function(*def.m_body_node, function_locals(param_names));
+              if (def.m_guard_node) {
+                resolve_function(*def.m_guard_node, function_locals(param_names));
+              }
+              break;
+            }
+            case AST_Node_Type::Method: {
+              auto &method = dynamic_cast<eval::Method_AST_Node<T> &>(t_node);
+              std::vector<std::string> param_names{"this"};
+              if (method.children.size() > 2 && method.children[2]->identifier == AST_Node_Type::Arg_List) {
+                const auto args = eval::Arg_List_AST_Node<T>::get_arg_names(*method.children[2]);
+                param_names.insert(param_names.end(), args.begin(), args.end());
+              }
+              resolve_function(*method.m_body_node, function_locals(param_names));
+              if (method.m_guard_node) {
+                resolve_function(*method.m_guard_node, function_locals(param_names));
+              }
+              break;
+            }
+            case AST_Node_Type::Lambda: {
+              auto &lambda = dynamic_cast<eval::Lambda_AST_Node<T> &>(t_node);
+              std::vector<std::string> captures;
+              for (const auto &capture : lambda.children[0]->children) {
+                visit(*capture->children[0]);
+                captures.push_back(capture->children[0]->text);
+              }
+              resolve_function(*lambda.m_lambda_node,
+                  function_locals(eval::Arg_List_AST_Node<T>::get_arg_names(*lambda.children[1]), std::move(captures),
+                    eval::Lambda_AST_Node<T>::has_this_capture(lambda.children[0]->children)));
+              break;
+            }
+            case AST_Node_Type::Compiled: {
+              const auto &original = *dynamic_cast<eval::Compiled_AST_Node<T> &>(t_node).m_original_node;
+              if (original.identifier == AST_Node_Type::For) {
+                // see For_Loop
+                push_scope();
+                declare(child_at(original, 0).children[0]->text);
+                visit_children(t_node);
+                pop_scope();
+              } else {
+                m_dynamic = true;
+                visit_children(t_node);
+              }
+              break;
+            }
+            default:
+              visit_children(t_node);
+          }
+        }
+
+        const bool m_active;
+        bool m_dynamic = false;
+        std::vector<std::vector<std::string>> m_scopes;
+        std::vector<std::tuple<eval::Id_AST_Node<T> *, std::size_t, std::size_t>> m_resolved;
+    };
+
+    struct Resolve_Locals {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::File) {
+          Local_Resolver<T>::resolve_functions(*node);
+        }
+
+        return node;
+      }
+    };
+
+    /// Calls t_func with the body of each function defined in t_node, and the names the function
+    /// declares before evaluating it: parameters, captures and "this"
+    template<typename T, typename Callable>
+      void for_each_function(eval::AST_Node_Impl<T> &t_node, const Callable &t_func)
+      {
+        for (auto &child : t_node.children) {
+          for_each_function(*child, t_func);
+        }
+
+        if (auto def = dynamic_cast<eval::Def_AST_Node<T> *>(&t_node)) {
+          for_each_function(*def->m_body_node, t_func);
+          auto params = (def->children.size() > 1 && def->children[1]->identifier == AST_Node_Type::Arg_List)
+            ? eval::Arg_List_AST_Node<T>::get_arg_names(*def->children[1]) : std::vector<std::string>();
+          params.emplace_back("this");
+          t_func(def->m_body_node, params);
+        } else if (auto method = dynamic_cast<eval::Method_AST_Node<T> *>(&t_node)) {
+          for_each_function(*method->m_body_node, t_func);
+          std::vector<std::string> params{"this"};
+          if (method->children.size() > 2 && method->children[2]->identifier == AST_Node_Type::Arg_List) {
+            const auto args = eval::Arg_List_AST_Node<T>::get_arg_names(*method->children[2]);
+            params.insert(params.end(), args.begin(), args.end());
+          }
+          t_func(method->m_body_node, params);
+        } else if (auto lambda = dynamic_cast<eval::Lambda_AST_Node<T> *>(&t_node)) {
+          for_each_function(*lambda->m_lambda_node, t_func);
+          auto params = eval::Arg_List_AST_Node<T>::get_arg_names(*lambda->children[1]);
+          for (const auto &capture : lambda->children[0]->children) {
+            params.push_back(capture->children[0]->text);
+          }
+          params.emplace_back("this");
+          t_func(lambda->m_lambda_node, params);
+        }
+      }
+
+    /// Whether the node defines a function or a class, whose bodies are not part of the enclosing function
+    template<typename T>
+      bool is_nested_function(const eval::AST_Node_Impl<T> &t_node)
+      {
+        return t_node.identifier == AST_Node_Type::Def || t_node.identifier == AST_Node_Type::Method
+          || t_node.identifier == AST_Node_Type::Lambda || t_node.identifier == AST_Node_Type::Class;
+      }
+
+    /// Prefix operators that only compute a new value from an arithmetic operand
+    inline bool is_pure_prefix(const std::string &t_oper)
+    {
+      return t_oper == "-" || t_oper == "+" || t_oper == "!" || t_oper == "~";
+    }
+
+    /// Adds the names of the objects the node declares or assigns to t_names, without looking into nested functions
+    template<typename T>
+      void assigned_names(const eval::AST_Node_Impl<T> &t_node, std::set<std::string> &t_names)
+      {
+        switch (t_node.identifier) {
+          case AST_Node_Type::Def:
+          case AST_Node_Type::Method:
+          case AST_Node_Type::Lambda:
+          case AST_Node_Type::Class:
+            return;
+          case AST_Node_Type::Equation:
+            if (t_node.children[0]->identifier == AST_Node_Type::Id) {
+              t_names.insert(t_node.children[0]->text);
+            }
+            break;
+          case AST_Node_Type::Prefix:
+            if ((t_node.text == "++" || t_node.text == "--") && t_node.children[0]->identifier == AST_Node_Type::Id) {
+              t_names.insert(t_node.children[0]->text);
+            }
+            break;
+          case AST_Node_Type::Var_Decl:
+          case AST_Node_Type::Assign_Decl:
+          case AST_Node_Type::Reference:
+          case AST_Node_Type::Ranged_For:
+            t_names.insert(t_node.children[0]->text);
+            break;
+          case AST_Node_Type::Compiled: {
+            const auto &original = *dynamic_cast<const eval::Compiled_AST_Node<T> &>(t_node).m_original_node;
+            if (original.identifier == AST_Node_Type::For) {
+              t_names.insert(child_at(original, 0).children[0]->text);
+            }
+            break;
+          }
+          default:
+            break;
+        }
+
+        for (const auto &child : t_node.children) {
+          assigned_names(*child, t_names);
+        }
+      }
+
+    /// Finds the locals of a function body that nothing but the body's own assignments can change.
+    /// Such a local is declared once, and it is only read as the operand of an operator, of a condition
+    /// or of an assignment, so it is never passed to a function, captured, returned or bound to a
+    /// reference. The values assigned to it are made by the assignment (constants, other objects, which
+    /// are copied, and operators), so it shares its value with nothing else either. Operators on objects
+    /// that aren't arithmetic are function calls, which are expected to not keep references to their
+    /// operands. Bodies calling eval have no such locals, as their declarations can't be known.
+    template<typename T>
+    class Private_Locals
+    {
+      public:
+        Private_Locals(const eval::AST_Node_Impl<T> &t_body, const std::vector<std::string> &t_params)
+          : m_escaped(t_params.begin(), t_params.end())
+        {
+          scan(t_body);
+        }
+
+        bool contains(const std::string &t_name) const
+        {
+          const auto itr = m_declarations.find(t_name);
+          return !m_dynamic && itr != m_declarations.end() && itr->second == 1 && m_escaped.count(t_name) == 0;
+        }
+
+        bool empty() const
+        {
+          return m_dynamic || std::none_of(m_declarations.begin(), m_declarations.end(),
+              [this](const auto &t_declaration) { return this->contains(t_declaration.first); });
+        }
+
+      private:
+        static bool produces_value(const eval::AST_Node_Impl<T> &t_node)
+        {
+          switch (t_node.identifier) {
+            case AST_Node_Type::Constant:
+            case AST_Node_Type::Id:
+            case AST_Node_Type::Binary:
+            case AST_Node_Type::Logical_And:
+            case AST_Node_Type::Logical_Or:
+              return true;
+            case AST_Node_Type::Prefix:
+              return is_pure_prefix(t_node.text);
+            default:
+              return false;
+          }
+        }
+
+        void operand(const eval::AST_Node_Impl<T> &t_node)
+        {
+          if (t_node.identifier != AST_Node_Type::Id) {
+            scan(t_node);
+          }
+        }
+
+        void assigned(const std::string &t_name, const eval::AST_Node_Impl<T> &t_value)
+        {
+          if (!produces_value(t_value)) {
+            m_escaped.insert(t_name);
+          }
+          operand(t_value);
+        }
+
+        void scan_children(const eval::AST_Node_Impl<T> &t_node)
+        {
+          for (const auto &child : t_node.children) {
+            scan(*child);
+          }
+        }
+
+        void scan(const eval::AST_Node_Impl<T> &t_node)
+        {
+          switch (t_node.identifier) {
+            case AST_Node_Type::Constant:
+              break;
+            case AST_Node_Type::Var_Decl:
+              ++m_declarations[t_node.children[0]->text];
+              break;
+            case AST_Node_Type::Assign_Decl:
+              ++m_declarations[t_node.children[0]->text];
+              assigned(t_node.children[0]->text, *t_node.children[1]);
+              break;
+            case AST_Node_Type::Equation:
+              if (t_node.children[0]->identifier == AST_Node_Type::Id && t_node.text != ":=") {
+                assigned(t_node.children[0]->text, *t_node.children[1]);
+              } else {
+                // such as a declaration bound to the right hand side with :=
+                assigned_names(*t_node.children[0], m_escaped);
+                scan_children(t_node);
+              }
+              break;
+            case AST_Node_Type::Prefix:
+              if ((t_node.text == "++" || t_node.text == "--") && t_node.children[0]->identifier == AST_Node_Type::Id) {
+                break;
+              } else if (is_pure_prefix(t_node.text)) {
+                operand(*t_node.children[0]);
+              } else {
+                scan_children(t_node);
+              }
+              break;
+            case AST_Node_Type::Binary:
+            case AST_Node_Type::Logical_And:
+            case AST_Node_Type::Logical_Or:
+              operand(*t_node.children[0]);
+              operand(*t_node.children[1]);
+              break;
+            case AST_Node_Type::If:
+            case AST_Node_Type::While:
+              operand(*t_node.children[0]);
+              for (std::size_t i = 1; i < t_node.children.size(); ++i) {
+                scan(*t_node.children[i]);
+              }
+              break;
+            case AST_Node_Type::For:
+              scan(*t_node.children[0]);
+              operand(*t_node.children[1]);
+              scan(*t_node.children[2]);
+              scan(*t_node.children[3]);
+              break;
+            case AST_Node_Type::Compiled: {
+              const auto &original = *dynamic_cast<const eval::Compiled_AST_Node<T> &>(t_node).m_original_node;
+              if (original.identifier == AST_Node_Type::For) {
+                m_escaped.insert(child_at(original, 0).children[0]->text);
+              } else {
+                m_dynamic = true;
+              }
+              scan_children(t_node);
+              break;
+            }
+            case AST_Node_Type::Fun_Call:
+            case AST_Node_Type::Unused_Return_Fun_Call: {
+              const auto &fun = *t_node.children[0];
+              if (fun.identifier == AST_Node_Type::Id
+                  && (fun.text == "eval" || fun.text == "eval_file" || fun.text == "use")) {
+                m_dynamic = true;
+              }
+              scan_children(t_node);
+              break;
+            }
+            case AST_Node_Type::Def:
+            case AST_Node_Type::Method:
+            case AST_Node_Type::Class:
+              break;
+            case AST_Node_Type::Lambda:
+              // captures are copied from the enclosing function, and share their values with it
+              scan(*t_node.children[0]);
+              break;
+            default:
+              // any other use of a name lets the object escape, be it an Id read where its value can
+              // be kept, or a declaration of another kind
+              m_escaped.insert(t_node.text);
+              scan_children(t_node);
+          }
+        }
+
+        std::map<std::string, int> m_declarations;
+        std::set<std::string> m_escaped;
+        bool m_dynamic = false;
+    };
+
+    /// The passes that fold the nodes whose children were replaced by constants
+    typedef Optimizer<optimizer::Partial_Fold, optimizer::Constant_Fold, optimizer::Arithmetic, optimizer::If> Refold;
+
+    /// Replaces the reads of the private locals of a function body, see Private_Locals, by the constants
+    /// last assigned to them, following the order of evaluation. Where the paths of an if or of a logical
+    /// operator meet, only the values that agree are kept. Loops, switches and try blocks keep the values
+    /// of the locals they don't assign. Only constants of arithmetic types and bool are propagated.
+    template<typename T>
+    class Constant_Propagator
+    {
+      public:
+        static void propagate(eval::AST_Node_Impl<T> &t_body, const Private_Locals<T> &t_locals)
+        {
+          if (t_locals.empty()) {
+            return;
+          }
+
+          Constant_Propagator propagator(t_locals);
+          Values values;
+          propagator.visit_children(t_body, values);
+        }
+
+      private:
+        typedef std::map<std::string, Boxed_Value> Values;
+
+        explicit Constant_Propagator(const Private_Locals<T> &t_locals)
+          : m_locals(t_locals)
+        {
+        }
+
+        static const Boxed_Value *constant_value(const eval::AST_Node_Impl<T> &t_node)
+        {
+          if (t_node.identifier == AST_Node_Type::Constant) {
+            const auto &value = dynamic_cast<const eval::Constant_AST_Node<T> &>(t_node).m_value;
+            if (value.get_type_info().is_arithmetic() || value.get_type_info().bare_equal_type_info(typeid(bool))) {
+              return &value;
+            }
+          }
+          return nullptr;
+        }
+
+        /// Keeps in t_values the values t_other agrees with
+        static void merge(Values &t_values, const Values &t_other)
+        {
+          for (auto itr = t_values.begin(); itr != t_values.end();) {
+            const auto other = t_other.find(itr->first);
+            if (other == t_other.end() || other->second.get_const_ptr() != itr->second.get_const_ptr()) {
+              itr = t_values.erase(itr);
+            } else {
+              ++itr;
+            }
+          }
+        }
+
+        void declare(const std::string &t_name, const eval::AST_Node_Impl<T> *t_value, Values &t_values) const
+        {
+          if (m_locals.contains(t_name)) {
+            const auto value = t_value ? constant_value(*t_value) : nullptr;
+            if (!t_value) {
+              t_values[t_name] = Boxed_Value();
+            } else if (value) {
+              t_values[t_name] = *value;
+            } else {
+              t_values.erase(t_name);
+            }
+          }
+        }
+
+        /// Tracks "=", which keeps the type of a defined left hand side
+        void assign(const std::string &t_name, const eval::AST_Node_Impl<T> &t_value, Values &t_values) const
+        {
+          const auto itr = t_values.find(t_name);
+          if (itr != t_values.end()) {
+            const auto value = constant_value(t_value);
+            if (value && (itr->second.is_undef() || itr->second.get_type_info().bare_equal(value->get_type_info()))) {
+              itr->second = *value;
+            } else {
+              t_values.erase(itr);
+            }
+          }
+        }
+
+        bool visit_children(eval::AST_Node_Impl<T> &t_node, Values &t_values)
+        {
+          bool changed = false;
+          for (auto &child : t_node.children) {
+            changed = visit(child, t_values) || changed;
+          }
+          return changed;
+        }
+
+        /// Visits the children of a node that may evaluate them in any order, or more than once
+        bool visit_unordered(eval::AST_Node_Impl<T> &t_node, Values &t_values)
+        {
+          std::set<std::string> assigned;
+          assigned_names(t_node, assigned);
+          for (const auto &name : assigned) {
+            t_values.erase(name);
+          }
+
+          bool changed = false;
+          for (auto &child : t_node.children) {
+            auto child_values = t_values;
+            changed = visit(child, child_values) || changed;
+          }
+          return changed;
+        }
+
+        /// Returns whether the node was replaced or changed, in which case it is folded again
+        bool visit(eval::AST_Node_Impl_Ptr<T> &t_node, Values &t_values)
+        {
+          auto &node = *t_node;
+          bool changed = false;
+
+          switch (node.identifier) {
+            case AST_Node_Type::Id: {
+              const auto itr = t_values.find(node.text);
+              if (itr != t_values.end() && !itr->second.is_undef()) {
+                t_node = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(node.text, node.location, itr->second);
+                return true;
+              }
+              return false;
+            }
+            case AST_Node_Type::Var_Decl:
+              declare(node.children[0]->text, nullptr, t_values);
+              return false;
+            case AST_Node_Type::Assign_Decl:
+              changed = visit(node.children[1], t_values);
+              declare(node.children[0]->text, node.children[1].get(), t_values);
+              return changed;
+            case AST_Node_Type::Equation:
+              changed = visit(node.children[1], t_values);
+              if (node.children[0]->identifier == AST_Node_Type::Id) {
+                if (node.text == "=") {
+                  assign(node.children[0]->text, *node.children[1], t_values);
+                } else {
+                  t_values.erase(node.children[0]->text);
+                }
+                return changed;
+              }
+              return visit(node.children[0], t_values) || changed;
+            case AST_Node_Type::Prefix:
+              if ((node.text == "++" || node.text == "--") && node.children[0]->identifier == AST_Node_Type::Id) {
+                t_values.erase(node.children[0]->text);
+                return false;
+              }
+              changed = visit(node.children[0], t_values);
+              break;
+            case AST_Node_Type::If: {
+              changed = visit(node.children[0], t_values);
+              auto else_values = t_values;
+              changed = visit(node.children[1], t_values) || changed;
+              changed = visit(node.children[2], else_values) || changed;
+              merge(t_values, else_values);
+              break;
+            }
+            case AST_Node_Type::Logical_And:
+            case AST_Node_Type::Logical_Or: {
+              changed = visit(node.children[0], t_values);
+              auto rhs_values = t_values;
+              changed = visit(node.children[1], rhs_values) || changed;
+              merge(t_values, rhs_values);
+              break;
+            }
+            case AST_Node_Type::Block: {
+              std::set<std::string> outer;
+              for (const auto &value : t_values) {
+                outer.insert(value.first);
+              }
+              changed = visit_children(node, t_values);
+              for (auto itr = t_values.begin(); itr != t_values.end();) {
+                itr = outer.count(itr->first) ? std::next(itr) : t_values.erase(itr);
+              }
+              return changed;
+            }
+            case AST_Node_Type::While:
+            case AST_Node_Type::For:
+            case AST_Node_Type::Ranged_For:
+            case AST_Node_Type::Compiled:
+            case AST_Node_Type::Switch:
+            case AST_Node_Type::Try:
+              return visit_unordered(node, t_values);
+            case AST_Node_Type::Dot_Access:
+              changed = visit(node.children[0], t_values);
+              if (node.children[1]->identifier == AST_Node_Type::Fun_Call) {
+                changed = visit(node.children[1]->children[1], t_values) || changed;
+              }
+              return changed;
+            case AST_Node_Type::Def:
+            case AST_Node_Type::Method:
+            case AST_Node_Type::Lambda:
+            case AST_Node_Type::Class:
+              return false;
+            default:
+              changed = visit_children(node, t_values);
+          }
+
+          if (changed) {
+            t_node = Refold().optimize(std::move(t_node));
+          }
+          return changed;
+        }
+
+        const Private_Locals<T> &m_locals;
+    };
+
+    struct Constant_Propagation {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::File) {
+          for_each_function(*node, [](std::shared_ptr<eval::AST_Node_Impl<T>> &t_body, const std::vector<std::string> &t_params) {
+              Constant_Propagator<T>::propagate(*t_body, Private_Locals<T>(*t_body, t_params));
+            });
+        }
+
+        return node;
+      }
+    };
+
+    /// Replaces the calls, made from function bodies, to small functions defined at file scope by
+    /// copies of their bodies, see eval::Inline_Fun_Call_AST_Node. A function is inlined when it has
+    /// a single definition, no guard, no parameter types, and its body is an operator applied to its
+    /// parameters, constants and calls to other functions, reading each parameter at least once. The
+    /// arguments of the call must be constants or objects, which the copy reads in place of the
+    /// parameters, and the names called by the copy must not be locals of the calling function.
+    template<typename T>
+    class Function_Inliner
+    {
+      public:
+        static void inline_calls(eval::AST_Node_Impl<T> &t_file)
+        {
+          Function_Inliner inliner;
+          inliner.find_functions(t_file);
+          if (inliner.m_functions.empty()) {
+            return;
+          }
+
+          for_each_function(t_file, [&inliner](std::shared_ptr<eval::AST_Node_Impl<T>> &t_body, const std::vector<std::string> &t_params) {
+              inliner.inline_calls(*t_body, t_params);
+            });
+        }
+
+      private:
+        struct Function {
+          const AST_Node *body;
+          std::vector<std::string> params;
+          std::set<std::string> callees;
+          eval::AST_Node_Impl_Ptr<T> expression;
+        };
+
+        static const std::size_t max_size = 16;
+
+        /// The expression a function body evaluates to
+        static const eval::AST_Node_Impl<T> &expression(const eval::AST_Node_Impl<T> &t_body)
+        {
+          if ((t_body.identifier == AST_Node_Type::Block || t_body.identifier == AST_Node_Type::Scopeless_Block
+                || t_body.identifier == AST_Node_Type::Return)
+              && t_body.children.size() == 1) {
+            return expression(*t_body.children[0]);
+          }
+          return t_body;
+        }
+
+        static bool is_call(const eval::AST_Node_Impl<T> &t_node)
+        {
+          return t_node.identifier == AST_Node_Type::Fun_Call
+            && dynamic_cast<const eval::Fun_Call_AST_Node<T> *>(&t_node)
+            && !dynamic_cast<const eval::Unused_Return_Fun_Call_AST_Node<T> *>(&t_node)
+            && t_node.children[0]->identifier == AST_Node_Type::Id
+            && t_node.children[1]->identifier == AST_Node_Type::Arg_List;
+        }
+
+        /// Checks that the node can be copied into a caller, and counts its nodes
+        static bool inlinable(const eval::AST_Node_Impl<T> &t_node, const std::string &t_name, Function &t_function,
+            std::set<std::string> &t_used, std::size_t &t_size)
+        {
+          if (++t_size > max_size) {
+            return false;
+          }
+
+          const auto all_inlinable = [&](const std::vector<eval::AST_Node_Impl_Ptr<T>> &t_children) {
+            return std::all_of(t_children.begin(), t_children.end(),
+                [&](const auto &t_child) { return inlinable(*t_child, t_name, t_function, t_used, t_size); });
+          };
+
+          switch (t_node.identifier) {
+            case AST_Node_Type::Constant:
+              return true;
+            case AST_Node_Type::Id:
+              if (std::find(t_function.params.begin(), t_function.params.end(), t_node.text) != t_function.params.end()) {
+                t_used.insert(t_node.text);
+                return true;
+              }
+              return false;
+            case AST_Node_Type::Binary:
+            case AST_Node_Type::Logical_And:
+            case AST_Node_Type::Logical_Or:
+              return all_inlinable(t_node.children);
+            case AST_Node_Type::Prefix:
+              return is_pure_prefix(t_node.text) && all_inlinable(t_node.children);
+            case AST_Node_Type::Fun_Call: {
+              const auto &callee = t_node.children[0]->text;
+              if (!is_call(t_node) || callee == t_name
+                  || std::find(t_function.params.begin(), t_function.params.end(), callee) != t_function.params.end()) {
+                return false;
+              }
+              t_function.callees.insert(callee);
+              return all_inlinable(t_node.children[1]->children);
+            }
+            default:
+              return false;
+          }
+        }
+
+        /// Copies an inlinable expression, replacing the parameters by the arguments
+        static eval::AST_Node_Impl_Ptr<T> copy(const eval::AST_Node_Impl<T> &t_node, const std::map<std::string, const eval::AST_Node_Impl<T> *> &t_args)
+        {
+          std::vector<eval::AST_Node_Impl_Ptr<T>> children;
+          for (const auto &child : t_node.children) {
+            children.push_back(copy(*child, t_args));
+          }
+
+          switch (t_node.identifier) {
+            case AST_Node_Type::Constant:
+              return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(t_node.text, t_node.location,
+                  dynamic_cast<const eval::Constant_AST_Node<T> &>(t_node).m_value);
+            case AST_Node_Type::Id: {
+              const auto arg = t_args.find(t_node.text);
+              if (arg != t_args.end()) {
+                return copy(*arg->second, {});
+              }
+              return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Id_AST_Node<T>>(t_node.text, t_node.location);
+            }
+            case AST_Node_Type::Binary:
+              return Refold().optimize(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Binary_Operator_AST_Node<T>>(t_node.text, t_node.location, std::move(children)));
+            case AST_Node_Type::Logical_And:
+              return Refold().optimize(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Logical_And_AST_Node<T>>(t_node.text, t_node.location, std::move(children)));
+            case AST_Node_Type::Logical_Or:
+              return Refold().optimize(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Logical_Or_AST_Node<T>>(t_node.text, t_node.location, std::move(children)));
+            case AST_Node_Type::Prefix:
+              return Refold().optimize(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Prefix_AST_Node<T>>(t_node.text, t_node.location, std::move(children)));
+            case AST_Node_Type::Arg_List:
+              return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Arg_List_AST_Node<T>>(t_node.text, t_node.location, std::move(children));
+            case AST_Node_Type::Fun_Call:
+              return Refold().optimize(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Fun_Call_AST_Node<T>>(t_node.text, t_node.location, std::move(children)));
+            default:
+              throw std::runtime_error("Unexpected node in inlined function (internal error)");
+          }
+        }
+
+        void find_functions(eval::AST_Node_Impl<T> &t_file)
+        {
+          std::map<std::string, int> definitions;
+          for (const auto &child : t_file.children) {
+            if (child->identifier == AST_Node_Type::Def) {
+              ++definitions[child->children[0]->text];
+            }
+          }
+
+          for (const auto &child : t_file.children) {
+            const auto def = dynamic_cast<const eval::Def_AST_Node<T> *>(child.get());
+            if (!def || def->m_guard_node || definitions[def->children[0]->text] != 1) {
+              continue;
+            }
+
+            Function function;
+            function.body = def->m_body_node.get();
+            if (def->children.size() > 1 && def->children[1]->identifier == AST_Node_Type::Arg_List) {
+              const auto &args = def->children[1]->children;
+              if (std::any_of(args.begin(), args.end(), [](const auto &t_arg) { return t_arg->children.size() > 1; })) {
+                // typed parameters
+                continue;
+              }
+              function.params = eval::Arg_List_AST_Node<T>::get_arg_names(*def->children[1]);
+            }
+
+            const std::set<std::string> params(function.params.begin(), function.params.end());
+            const auto &body = expression(*def->m_body_node);
+            std::set<std::string> used;
+            std::size_t size = 0;
+            if (params.size() == function.params.size() && params.count("this") == 0
+                && (body.identifier == AST_Node_Type::Binary || body.identifier == AST_Node_Type::Prefix
+                  || body.identifier == AST_Node_Type::Logical_And || body.identifier == AST_Node_Type::Logical_Or)
+                && inlinable(body, def->children[0]->text, function, used, size)
+                && used == params) {
+              function.expression = copy(body, {});
+              m_functions.emplace(def->children[0]->text, std::move(function));
+            }
+          }
+        }
+
+        /// Adds the names declared by the function body to t_names
+        static void declared_names(const eval::AST_Node_Impl<T> &t_node, std::set<std::string> &t_names, bool &t_dynamic)
+        {
+          if (is_nested_function(t_node)) {
+            return;
+          } else if (t_node.identifier == AST_Node_Type::Compiled) {
+            const auto &original = *dynamic_cast<const eval::Compiled_AST_Node<T> &>(t_node).m_original_node;
+            if (original.identifier != AST_Node_Type::For) {
+              t_dynamic = true;
+            }
+          } else if (t_node.identifier == AST_Node_Type::Catch && t_node.children.size() > 1) {
+            t_names.insert(eval::Arg_List_AST_Node<T>::get_arg_name(*t_node.children[0]));
+          } else if ((t_node.identifier == AST_Node_Type::Fun_Call || t_node.identifier == AST_Node_Type::Unused_Return_Fun_Call)
+              && t_node.children[0]->identifier == AST_Node_Type::Id
+              && (t_node.children[0]->text == "eval" || t_node.children[0]->text == "eval_file" || t_node.children[0]->text == "use")) {
+            t_dynamic = true;
+          }
+
+          for (const auto &child : t_node.children) {
+            declared_names(*child, t_names, t_dynamic);
+          }
+        }
+
+        void inline_calls(eval::AST_Node_Impl<T> &t_body, const std::vector<std::string> &t_params)
+        {
+          std::set<std::string> locals(t_params.begin(), t_params.end());
+          bool dynamic = false;
+          assigned_names(t_body, locals);
+          declared_names(t_body, locals, dynamic);
+          if (!dynamic) {
+            visit_children(t_body, locals);
+          }
+        }
+
+        void visit_children(eval::AST_Node_Impl<T> &t_node, const std::set<std::string> &t_locals)
+        {
+          for (auto &child : t_node.children) {
+            visit(child, t_locals);
+          }
+        }
+
+        void visit(eval::AST_Node_Impl_Ptr<T> &t_node, const std::set<std::string> &t_locals)
+        {
+          if (is_nested_function(*t_node)) {
+            return;
+          }
+
+          visit_children(*t_node, t_locals);
+
+          if (!is_call(*t_node)) {
+            return;
+          }
+
+          const auto &name = t_node->children[0]->text;
+          const auto &args = t_node->children[1]->children;
+          const auto function = m_functions.find(name);
+          if (function == m_functions.end()
+              || function->second.params.size() != args.size()
+              || t_locals.count(name) != 0
+              || std::any_of(function->second.callees.begin(), function->second.callees.end(),
+                [&t_locals](const std::string &t_callee) { return t_locals.count(t_callee) != 0; })
+              || std::any_of(args.begin(), args.end(), [](const auto &t_arg) {
+                return t_arg->identifier != AST_Node_Type::Constant && t_arg->identifier != AST_Node_Type::Id; })) {
+            return;
+          }
+
+          std::map<std::string, const eval::AST_Node_Impl<T> *> arg_nodes;
+          for (std::size_t i = 0; i < args.size(); ++i) {
+            arg_nodes.emplace(function->second.params[i], args[i].get());
+          }
+
+          std::vector<eval::AST_Node_Impl_Ptr<T>> children;
+          children.push_back(copy(*function->second.expression, arg_nodes));
+          children.insert(children.begin(), std::move(t_node));
+          t_node = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Inline_Fun_Call_AST_Node<T>>(children[0]->text, children[0]->location,
+              std::move(children), function->second.body);
+        }
+
+        std::map<std::string, Function> m_functions;
+    };
+
+    struct Inline_Functions {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::File) {
+          Function_Inliner<T>::inline_calls(*node);
+        }
+
+        return node;
+      }
+    };
+
+    /// Moves the computations that give the same result on every iteration of a loop in a function
+    /// body out of the loop, see eval::Loop_Invariant_AST_Node. The loop is put in a block declaring
+    /// a local for each of them. They are arithmetic operators applied to constants and private locals
+    /// (see Private_Locals) declared before the loop and not assigned within it, and only the root of
+    /// one of them may compare.
+    template<typename T>
+    class Invariant_Hoister
+    {
+      public:
+        static void hoist(eval::AST_Node_Impl<T> &t_body, const Private_Locals<T> &t_locals)
+        {
+          if (t_locals.empty()) {
+            return;
+          }
+
+          Invariant_Hoister hoister(t_locals);
+          hoister.visit_children(t_body);
+        }
+
+      private:
+        explicit Invariant_Hoister(const Private_Locals<T> &t_locals)
+          : m_locals(t_locals)
+        {
+        }
+
+        static bool is_arithmetic_operator(const std::string &t_oper)
+        {
+          return t_oper == "+" || t_oper == "-" || t_oper == "*" || t_oper == "/" || t_oper == "%"
+            || t_oper == "<<" || t_oper == ">>" || t_oper == "&" || t_oper == "|" || t_oper == "^";
+        }
+
+        static bool is_comparison(const std::string &t_oper)
+        {
+          return t_oper == "<" || t_oper == ">" || t_oper == "<=" || t_oper == ">=" || t_oper == "==" || t_oper == "!=";
+        }
+
+        /// Checks that the node is invariant, and collects the locals it reads
+        bool invariant(const eval::AST_Node_Impl<T> &t_node, const std::set<std::string> &t_assigned, const bool t_root,
+            std::vector<const eval::AST_Node_Impl<T> *> &t_operands) const
+        {
+          switch (t_node.identifier) {
+            case AST_Node_Type::Constant:
+              return dynamic_cast<const eval::Constant_AST_Node<T> &>(t_node).m_value.get_type_info().is_arithmetic();
+            case AST_Node_Type::Id:
+              if (m_visible.count(t_node.text) != 0 && t_assigned.count(t_node.text) == 0) {
+                t_operands.push_back(&t_node);
+                return true;
+              }
+              return false;
+            case AST_Node_Type::Binary:
+              return (is_arithmetic_operator(t_node.text) || (t_root && is_comparison(t_node.text)))
+                && invariant(*t_node.children[0], t_assigned, false, t_operands)
+                && invariant(*t_node.children[1], t_assigned, false, t_operands);
+            case AST_Node_Type::Prefix:
+              return (t_node.text == "-" || t_node.text == "+" || t_node.text == "~")
+                && invariant(*t_node.children[0], t_assigned, false, t_operands);
+            default:
+              return false;
+          }
+        }
+
+        /// Replaces the invariants in the loop by eval::Loop_Invariant_AST_Node, adding the declarations
+        /// of the locals keeping their values to t_declarations
+        void extract(eval::AST_Node_Impl_Ptr<T> &t_node, const std::set<std::string> &t_assigned,
+            std::vector<eval::AST_Node_Impl_Ptr<T>> &t_declarations)
+        {
+          if (is_nested_function(*t_node) || dynamic_cast<const eval::Loop_Invariant_AST_Node<T> *>(t_node.get())) {
+            return;
+          }
+
+          std::vector<const eval::AST_Node_Impl<T> *> operands;
+          if ((t_node->identifier == AST_Node_Type::Binary || t_node->identifier == AST_Node_Type::Prefix)
+              && invariant(*t_node, t_assigned, true, operands) && !operands.empty()) {
+            const auto name = "$loop_invariant_" + std::to_string(m_count++);
+            const auto &location = t_node->location;
+
+            std::vector<eval::AST_Node_Impl_Ptr<T>> decl_children;
+            decl_children.push_back(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Id_AST_Node<T>>(name, location));
+            t_declarations.push_back(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Var_Decl_AST_Node<T>>("var", location, std::move(decl_children)));
+
+            std::vector<eval::AST_Node_Impl_Ptr<T>> children;
+            children.push_back(chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Id_AST_Node<T>>(name, location));
+            children.push_back(std::move(t_node));
+            t_node = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Loop_Invariant_AST_Node<T>>(children[1]->text, children[1]->identifier,
+                location, std::move(children), std::move(operands));
+            return;
+          }
+
+          for (auto &child : t_node->children) {
+            extract(child, t_assigned, t_declarations);
+          }
+        }
+
+        void visit_children(eval::AST_Node_Impl<T> &t_node)
+        {
+          for (auto &child : t_node.children) {
+            visit(child);
+          }
+        }
+
+        void visit(eval::AST_Node_Impl_Ptr<T> &t_node)
+        {
+          switch (t_node->identifier) {
+            case AST_Node_Type::Def:
+            case AST_Node_Type::Method:
+            case AST_Node_Type::Lambda:
+            case AST_Node_Type::Class:
+              return;
+            case AST_Node_Type::Var_Decl:
+            case AST_Node_Type::Assign_Decl:
+              visit_children(*t_node);
+              if (m_locals.contains(t_node->children[0]->text)) {
+                m_visible.insert(t_node->children[0]->text);
+              }
+              return;
+            case AST_Node_Type::While:
+            case AST_Node_Type::For:
+            case AST_Node_Type::Compiled:
+              if (t_node->identifier != AST_Node_Type::Compiled
+                  || dynamic_cast<const eval::Compiled_AST_Node<T> &>(*t_node).m_original_node->identifier == AST_Node_Type::For) {
+                visit_scoped(hoist_from(t_node));
+                return;
+              }
+              break;
+            default:
+              break;
+          }
+
+          visit_scoped(*t_node);
+        }
+
+        /// Visits the children of a node declaring nothing outside of itself
+        void visit_scoped(eval::AST_Node_Impl<T> &t_node)
+        {
+          const auto visible = m_visible;
+          visit_children(t_node);
+          m_visible = visible;
+        }
+
+        /// Returns the loop, which may have been put in a block
+        eval::AST_Node_Impl<T> &hoist_from(eval::AST_Node_Impl_Ptr<T> &t_loop)
+        {
+          std::set<std::string> assigned;
+          assigned_names(*t_loop, assigned);
+
+          std::vector<eval::AST_Node_Impl_Ptr<T>> declarations;
+          // the initialization of a for loop is evaluated once
+          for (auto i = std::size_t(t_loop->identifier == AST_Node_Type::For ? 1 : 0); i < t_loop->children.size(); ++i) {
+            extract(t_loop->children[i], assigned, declarations);
+          }
+
+          if (declarations.empty()) {
+            return *t_loop;
+          }
+
+          auto &loop = *t_loop;
+          declarations.push_back(std::move(t_loop));
+          t_loop = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Block_AST_Node<T>>("", loop.location, std::move(declarations));
+          return loop;
+        }
+
+        const Private_Locals<T> &m_locals;
+        std::set<std::string> m_visible;
+        std::size_t m_count = 0;
+    };
+
+    struct Loop_Invariant {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::File) {
+          for_each_function(*node, [](std::shared_ptr<eval::AST_Node_Impl<T>> &t_body, const std::vector<std::string> &t_params) {
+              Invariant_Hoister<T>::hoist(*t_body, Private_Locals<T>(*t_body, t_params));
+            });
+        }
+
+        return node;
+      }
+    };
+
+    typedef Optimizer<optimizer::Partial_Fold, optimizer::Unused_Return, optimizer::Constant_Fold, optimizer::Arithmetic,
+      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop, optimizer::Assign_Decl,
+      optimizer::Constant_Propagation, optimizer::Inline_Functions, optimizer::Loop_Invariant,
+      optimizer::Resolve_Locals> Optimizer_Default; 
 
   }
 }
@@ -26,6 +26,7 @@
 #include "../dispatchkit/boxed_value.hpp"
 #include "chaiscript_common.hpp"
 #include "chaiscript_optimizer.hpp"
+#include "chaiscript_bytecode.hpp"
 #include "chaiscript_tracer.hpp"
 #include "../utility/fnv1a.hpp"
 #include "../utility/static_string.hpp"
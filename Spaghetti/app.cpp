@@ -90,7 +90,7 @@ static Limits GetRequiredLimits(Adapter adapter) {
 
 #endif
 
-bool App::InitWGPU() {
+void App::CreateInstance() {
   wgpu::InstanceDescriptor instance_desc = {};
   // instance_desc.features.timedWaitAnyEnable = true;
   // instance_desc.features.timedWaitAnyMaxCount = 1;
@@ -108,41 +108,36 @@ bool App::InitWGPU() {
     nullptr);
   wgpuSetLogLevel(WGPULogLevel_Warn);
 #endif
+}
 
-  wgpu_surface = { glfwCreateWindowWGPUSurface(*wgpu_instance, window) };
-
-  WGPUTextureFormat preferred_format = WGPUTextureFormat_Undefined;
-
-#ifdef __EMSCRIPTEN__
-  getAdapterAndDeviceViaJS();
-
-  wgpu_device = emscripten_webgpu_get_device();
-  IM_ASSERT(wgpu_device != nullptr && "Error creating the Device");
-
-  WGPUSurfaceDescriptorFromCanvasHTMLSelector html_surface_desc = {};
-  html_surface_desc.chain.sType = WGPUSType_SurfaceDescriptorFromCanvasHTMLSelector;
-  html_surface_desc.selector = "#canvas";
-
-  WGPUSurfaceDescriptor surface_desc = {};
-  surface_desc.nextInChain = &html_surface_desc.chain;
-
-  // Create the surface.
-  wgpu_surface = { wgpuInstanceCreateSurface(*wgpu_instance, &surface_desc) };
-  preferred_format = wgpuSurfaceGetPreferredFormat(*wgpu_surface, {} /* adapter */);
-#else // __EMSCRIPTEN__
+#ifndef __EMSCRIPTEN__
 
+Adapter App::RequestAdapter(Surface compatibleSurface) {
   RequestAdapterOptions adapterOpts = {};
-  adapterOpts.compatibleSurface = *wgpu_surface;
+  adapterOpts.compatibleSurface = compatibleSurface;
   Adapter adapter = wgpu_instance->requestAdapter(adapterOpts);
+  if (!adapter) {
+    // No hardware adapter, e.g. on a CPU-only server: ask for a software one
+    std::cout << "Requesting fallback adapter..." << std::endl;
+    adapterOpts.forceFallbackAdapter = true;
+    adapter = wgpu_instance->requestAdapter(adapterOpts);
+  }
   std::cout << "Got adapter: " << adapter << std::endl;
   // ImGui_ImplWGPU_DebugPrintAdapterInfo(adapter);
+  return adapter;
+}
 
-  // instance.release();
-
+bool App::RequestDevice(Adapter adapter) {
   std::cout << "Requesting device..." << std::endl;
   DeviceDescriptor deviceDesc = {};
   deviceDesc.label = { "My Device", WGPU_STRLEN };
-  deviceDesc.requiredFeatureCount = 0;
+  // Timestamp queries are optional, the profiler falls back to CPU timings without them
+  std::vector<WGPUFeatureName> requiredFeatures;
+  if (adapter.hasFeature(FeatureName::TimestampQuery)) {
+    requiredFeatures.push_back(FeatureName::TimestampQuery);
+  }
+  deviceDesc.requiredFeatureCount = requiredFeatures.size();
+  deviceDesc.requiredFeatures = requiredFeatures.data();
   deviceDesc.defaultQueue.label = { "The default queue", WGPU_STRLEN };
   deviceDesc.deviceLostCallbackInfo.callback = [](WGPUDevice const* device,
                                                   WGPUDeviceLostReason reason,
@@ -174,6 +169,65 @@ bool App::InitWGPU() {
 
   wgpu_device = { adapter.requestDevice(deviceDesc) };
   std::cout << "Got device: " << *wgpu_device << std::endl;
+  if (!wgpu_device) {
+    return false;
+  }
+  timestampQuerySupported = wgpu_device->hasFeature(FeatureName::TimestampQuery);
+  wgpu_queue = { wgpu_device->getQueue() };
+  return true;
+}
+
+bool App::CreateHeadlessDevice() {
+  CreateInstance();
+  Adapter adapter = RequestAdapter(Surface{});
+  if (!adapter) {
+    return false;
+  }
+  bool const ok = RequestDevice(adapter);
+  adapter.release();
+  return ok;
+}
+
+void App::TickHeadless() {
+  NotifyNewFrame();
+  ProcessGpuEvents();
+}
+
+#endif // __EMSCRIPTEN__
+
+bool App::InitWGPU() {
+  CreateInstance();
+
+  wgpu_surface = { glfwCreateWindowWGPUSurface(*wgpu_instance, window) };
+
+  WGPUTextureFormat preferred_format = WGPUTextureFormat_Undefined;
+
+#ifdef __EMSCRIPTEN__
+  getAdapterAndDeviceViaJS();
+
+  wgpu_device = emscripten_webgpu_get_device();
+  IM_ASSERT(wgpu_device != nullptr && "Error creating the Device");
+
+  WGPUSurfaceDescriptorFromCanvasHTMLSelector html_surface_desc = {};
+  html_surface_desc.chain.sType = WGPUSType_SurfaceDescriptorFromCanvasHTMLSelector;
+  html_surface_desc.selector = "#canvas";
+
+  WGPUSurfaceDescriptor surface_desc = {};
+  surface_desc.nextInChain = &html_surface_desc.chain;
+
+  // Create the surface.
+  wgpu_surface = { wgpuInstanceCreateSurface(*wgpu_instance, &surface_desc) };
+  preferred_format = wgpuSurfaceGetPreferredFormat(*wgpu_surface, {} /* adapter */);
+#else // __EMSCRIPTEN__
+
+  Adapter adapter = RequestAdapter(*wgpu_surface);
+  if (!adapter) {
+    return false;
+  }
+  if (!RequestDevice(adapter)) {
+    adapter.release();
+    return false;
+  }
 
   SurfaceCapabilities capabilities{};
   wgpu_surface->getCapabilities(adapter, &capabilities);
@@ -181,7 +235,9 @@ bool App::InitWGPU() {
 
 #endif
 
+#ifdef __EMSCRIPTEN__
   wgpu_queue = { wgpu_device->getQueue() };
+#endif
 
   wgpu_surface_configuration.width = surfaceWidth;
   wgpu_surface_configuration.height = surfaceHeight;
@@ -214,6 +270,19 @@ bool App::IsIconified() const {
   return glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0;
 }
 
+void App::NotifyNewFrame() {
+  // by index, since a callback may register further ones
+  for (size_t i = 0; i < onNewFrame.size(); ++i) {
+    onNewFrame[i]();
+  }
+}
+
+void App::ProcessGpuEvents() {
+  if (wgpu_instance) {
+    wgpu_instance->processEvents();
+  }
+}
+
 void App::CreateWindowAndStartMainLoop(std::function<void()> lambda) {
   CreateMainWindow();
   SetAppUiLoop(std::move(lambda));
@@ -333,6 +402,7 @@ void App::StartMainLoop() {
     // clear/overwrite your copy of the keyboard data. Generally you may always pass all inputs to dear imgui, and hide
     // them from your application based on those two flags.
     glfwPollEvents();
+    NotifyNewFrame();
     if (IsIconified()) {
       ImGui_ImplGlfw_Sleep(10);
       continue;
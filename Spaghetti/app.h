@@ -26,17 +26,29 @@ public:
   wgpu::Device GetDevice() { return *wgpu_device; }
   wgpu::Queue GetQueue() { return *wgpu_queue; }
   bool IsIconified() const;
+  bool SupportsTimestampQuery() const { return timestampQuerySupported; }
+  void ProcessGpuEvents();
 
   void CreateWindowAndStartMainLoop(std::function<void()> lambda);
 
+  // Offscreen device with no window nor surface, falling back to a software adapter when there is no hardware one.
+  // Without a main loop, TickHeadless must be called once per evaluated frame.
+  bool CreateHeadlessDevice();
+  void TickHeadless();
+
 public:
   std::array<float, 4> clearColor;
   std::vector<std::function<void(int, int)>> onWindowSizeChanged;
+  std::vector<std::function<void()>> onNewFrame;
 
 private:
   App();
 
   bool InitWGPU();
+  void CreateInstance();
+  wgpu::Adapter RequestAdapter(wgpu::Surface compatibleSurface);
+  bool RequestDevice(wgpu::Adapter adapter);
+  void NotifyNewFrame();
   void ResizeSurface(int width, int height);
   bool WindowShouldClose();
   bool CreateAndShowWindow();
@@ -47,6 +59,7 @@ private:
   int surfaceWidth = 1280;
   int surfaceHeight = 800;
   std::function<void()> appUiLoop;
+  bool timestampQuerySupported = false;
 
 private:
   wgpu::raii::Instance wgpu_instance{};
@@ -0,0 +1,511 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "builtin_kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <type_traits>
+
+template<class Body>
+static void ForChunks(size_t count, Body const& body) {
+  if (count < kernel_parallel_threshold) {
+    body(0, count);
+    return;
+  }
+  ThreadPool::Get().ParallelFor(count, kernel_chunk_size, body);
+}
+
+static size_t GetNumChunks(size_t count) {
+  return count < kernel_parallel_threshold ? 1 : (count + kernel_chunk_size - 1) / kernel_chunk_size;
+}
+
+static size_t GetChunkIndex(size_t count, size_t begin) {
+  return count < kernel_parallel_threshold ? 0 : begin / kernel_chunk_size;
+}
+
+// __restrict and an inlined op let compilers vectorize, as in CurveLut
+template<class T, class Op>
+static void Elementwise(T const* __restrict a, T const* __restrict b, T* __restrict out, size_t count, Op op) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = op(a[i], b[i]);
+  }
+}
+
+template<class T, class Op>
+static void Elementwise(
+  T const* __restrict a, T const* __restrict b, T const* __restrict c, T* __restrict out, size_t count, Op op) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = op(a[i], b[i], c[i]);
+  }
+}
+
+template<class T>
+void ApplyBinary(BinaryOp op, T const* a, T const* b, T* out, size_t count) {
+  ForChunks(count, [&](size_t begin, size_t end) {
+    auto const n = end - begin;
+    auto const x = a + begin;
+    auto const y = b + begin;
+    auto const z = out + begin;
+    switch (op) {
+      case BinaryOp::add:
+        Elementwise(x, y, z, n, [](T a, T b) { return a + b; });
+        break;
+      case BinaryOp::subtract:
+        Elementwise(x, y, z, n, [](T a, T b) { return a - b; });
+        break;
+      case BinaryOp::multiply:
+        Elementwise(x, y, z, n, [](T a, T b) { return a * b; });
+        break;
+      case BinaryOp::divide:
+        if constexpr (std::is_floating_point_v<T>) {
+          Elementwise(x, y, z, n, [](T a, T b) { return a / b; });
+        }
+        else {
+          Elementwise(x, y, z, n, [](T a, T b) { return b != 0 ? T(a / b) : T(0); });
+        }
+        break;
+      case BinaryOp::min:
+        Elementwise(x, y, z, n, [](T a, T b) { return b < a ? b : a; });
+        break;
+      case BinaryOp::max:
+        Elementwise(x, y, z, n, [](T a, T b) { return a < b ? b : a; });
+        break;
+    }
+  });
+}
+
+template<class T>
+void Clamp(T const* x, T const* low, T const* high, T* out, size_t count) {
+  ForChunks(count, [&](size_t begin, size_t end) {
+    Elementwise(x + begin, low + begin, high + begin, out + begin, end - begin, [](T x, T low, T high) {
+      x = x < low ? low : x;
+      return high < x ? high : x;
+    });
+  });
+}
+
+void Mix(float const* a, float const* b, float const* t, float* out, size_t count) {
+  ForChunks(count, [&](size_t begin, size_t end) {
+    Elementwise(a + begin, b + begin, t + begin, out + begin, end - begin, [](float a, float b, float t) {
+      return a + (b - a) * t;
+    });
+  });
+}
+
+static void RemapRange(float const* __restrict x,
+                       float const* __restrict in_min,
+                       float const* __restrict in_max,
+                       float const* __restrict out_min,
+                       float const* __restrict out_max,
+                       float* __restrict out,
+                       size_t count) {
+  // empty input ranges are fixed in a second pass: a division under a condition would not vectorize
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = out_min[i] + (out_max[i] - out_min[i]) * ((x[i] - in_min[i]) / (in_max[i] - in_min[i]));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = in_max[i] == in_min[i] ? out_min[i] : out[i];
+  }
+}
+
+void Remap(float const* x,
+           float const* in_min,
+           float const* in_max,
+           float const* out_min,
+           float const* out_max,
+           float* out,
+           size_t count) {
+  ForChunks(count, [&](size_t begin, size_t end) {
+    RemapRange(
+      x + begin, in_min + begin, in_max + begin, out_min + begin, out_max + begin, out + begin, end - begin);
+  });
+}
+
+// with independent accumulators, so that floating point reductions vectorize without reassociating
+template<class T, class Op>
+static T ReduceRange(T const* __restrict x, size_t count, T identity, Op op) {
+  constexpr size_t lanes = 8;
+  T accumulators[lanes];
+  for (auto& a : accumulators) {
+    a = identity;
+  }
+  size_t i = 0;
+  for (; i + lanes <= count; i += lanes) {
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      accumulators[lane] = op(accumulators[lane], x[i + lane]);
+    }
+  }
+  for (; i < count; ++i) {
+    accumulators[0] = op(accumulators[0], x[i]);
+  }
+  auto result = identity;
+  for (auto a : accumulators) {
+    result = op(result, a);
+  }
+  return result;
+}
+
+template<class T, class Op>
+static T ReduceChunks(T const* x, size_t count, T identity, Op op) {
+  std::vector<T> partials(GetNumChunks(count), identity);
+  ForChunks(count, [&](size_t begin, size_t end) {
+    partials[GetChunkIndex(count, begin)] = ReduceRange(x + begin, end - begin, identity, op);
+  });
+  return ReduceRange(partials.data(), partials.size(), identity, op);
+}
+
+template<class T>
+T Reduce(Reduction reduction, T const* x, size_t count) {
+  switch (reduction) {
+    case Reduction::sum:
+      return ReduceChunks(x, count, T(0), [](T a, T b) { return a + b; });
+    case Reduction::mean:
+      return count > 0 ? T(ReduceChunks(x, count, T(0), [](T a, T b) { return a + b; }) / T(count)) : T(0);
+    case Reduction::min:
+      if (count == 0) {
+        return T(0);
+      }
+      return ReduceChunks(x, count, x[0], [](T a, T b) { return b < a ? b : a; });
+    case Reduction::max:
+      if (count == 0) {
+        return T(0);
+      }
+      return ReduceChunks(x, count, x[0], [](T a, T b) { return a < b ? b : a; });
+  }
+  return T(0);
+}
+
+template<class T>
+static void Offset(T* __restrict x, size_t count, T offset) {
+  for (size_t i = 0; i < count; ++i) {
+    x[i] += offset;
+  }
+}
+
+template<class T>
+void PrefixSum(T const* x, T* out, size_t count) {
+  // each chunk is scanned on its own, then offset by the sum of the chunks before it
+  std::vector<T> totals(GetNumChunks(count), T(0));
+  ForChunks(count, [&](size_t begin, size_t end) {
+    auto sum = T(0);
+    for (auto i = begin; i < end; ++i) {
+      sum += x[i];
+      out[i] = sum;
+    }
+    totals[GetChunkIndex(count, begin)] = sum;
+  });
+  if (totals.size() == 1) {
+    return;
+  }
+  for (size_t i = 1; i < totals.size(); ++i) {
+    totals[i] += totals[i - 1];
+  }
+  ForChunks(count, [&](size_t begin, size_t end) {
+    auto const chunk = GetChunkIndex(count, begin);
+    if (chunk > 0) {
+      Offset(out + begin, end - begin, totals[chunk - 1]);
+    }
+  });
+}
+
+template<class T>
+void Sort(T* x, size_t count) {
+  if (count < kernel_parallel_threshold) {
+    std::sort(x, x + count);
+    return;
+  }
+  // sorted chunks, merged pairwise in rounds
+  ForChunks(count, [&](size_t begin, size_t end) { std::sort(x + begin, x + end); });
+  for (auto width = kernel_chunk_size; width < count; width *= 2) {
+    auto const num_pairs = (count + 2 * width - 1) / (2 * width);
+    ThreadPool::Get().ParallelFor(num_pairs, 1, [&](size_t first_pair, size_t last_pair) {
+      for (auto pair = first_pair; pair < last_pair; ++pair) {
+        auto const begin = pair * 2 * width;
+        auto const middle = std::min(begin + width, count);
+        auto const end = std::min(begin + 2 * width, count);
+        std::inplace_merge(x + begin, x + middle, x + end);
+      }
+    });
+  }
+}
+
+void Histogram(float const* x, size_t count, float min, float max, uint32_t* bins, uint32_t num_bins) {
+  std::fill(bins, bins + num_bins, 0u);
+  if (num_bins == 0 || !(max > min)) {
+    return;
+  }
+  auto const scale = float(num_bins) / (max - min);
+  std::vector<std::vector<uint32_t>> partials(GetNumChunks(count));
+  ForChunks(count, [&](size_t begin, size_t end) {
+    auto& partial = partials[GetChunkIndex(count, begin)];
+    partial.assign(num_bins, 0u);
+    for (auto i = begin; i < end; ++i) {
+      auto const position = (x[i] - min) * scale;
+      if (position >= 0.f && position < float(num_bins)) {
+        ++partial[uint32_t(position)];
+      }
+    }
+  });
+  for (auto const& partial : partials) {
+    for (uint32_t i = 0; i < partial.size(); ++i) {
+      bins[i] += partial[i];
+    }
+  }
+}
+
+#define INSTANTIATE_KERNELS(T)                                                                                         \
+  template void ApplyBinary<T>(BinaryOp, T const*, T const*, T*, size_t);                                              \
+  template void Clamp<T>(T const*, T const*, T const*, T*, size_t);                                                    \
+  template T Reduce<T>(Reduction, T const*, size_t);                                                                   \
+  template void PrefixSum<T>(T const*, T*, size_t);                                                                    \
+  template void Sort<T>(T*, size_t);
+
+INSTANTIATE_KERNELS(float)
+INSTANTIATE_KERNELS(int32_t)
+INSTANTIATE_KERNELS(uint32_t)
+
+// Value data is stored as arrays of coordinates: the calls below gather each coordinate into a contiguous column
+// for the kernels, and scatter the results back.
+
+template<class DataClass>
+using Column = std::vector<typename DataClass::ElementType>;
+
+// the input with the given array length and number of coordinates, broadcasting its dimensions of size one,
+// column after column
+template<class DataClass>
+static Column<DataClass> Gather(Input const& input, uint32_t array_length, uint32_t num_coords) {
+  auto const view = input.GetView<DataClass>();
+  auto const broadcast_array = view.GetArrayLength() == 1;
+  auto const broadcast_coords = view.GetNumCoords() == 1;
+  auto column = Column<DataClass>(size_t(array_length) * num_coords);
+  for (uint32_t c = 0; c < num_coords; ++c) {
+    auto const in_c = broadcast_coords ? 0 : c;
+    auto const out = column.data() + size_t(c) * array_length;
+    if (broadcast_array) {
+      std::fill(out, out + array_length, view(0, in_c));
+      continue;
+    }
+    for (uint32_t i = 0; i < array_length; ++i) {
+      out[i] = view(i, in_c);
+    }
+  }
+  return column;
+}
+
+template<class DataClass>
+static void Scatter(Column<DataClass> const& column, Data& output) {
+  auto& data = static_cast<DataClass&>(output).data;
+  auto const array_length = output.signature.array_length;
+  auto const num_coords = output.signature.num_coords;
+  data.resize(array_length);
+  for (uint32_t i = 0; i < array_length; ++i) {
+    data[i].resize(num_coords);
+    for (uint32_t c = 0; c < num_coords; ++c) {
+      data[i][c] = column[size_t(c) * array_length + i];
+    }
+  }
+}
+
+static bool HasValueInputs(std::vector<Input> const& inputs,
+                           std::vector<std::unique_ptr<Data>> const& outputs,
+                           size_t num_inputs,
+                           Encoding encoding) {
+  if (inputs.size() < num_inputs || outputs.empty() || !outputs[0] || outputs[0]->signature.type != Type::value) {
+    return false;
+  }
+  for (size_t i = 0; i < num_inputs; ++i) {
+    if (inputs[i].signature.type != Type::value || inputs[i].signature.encoding != encoding) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// calls function(std::type_identity<DataClass>{}) with the data class of the encoding
+template<class Function>
+static void ForEncoding(Encoding encoding, Function const& function) {
+  switch (encoding) {
+    case Encoding::floating:
+      function(std::type_identity<Floating>{});
+      break;
+    case Encoding::sinteger:
+      function(std::type_identity<SInteger>{});
+      break;
+    case Encoding::uinteger:
+      function(std::type_identity<UInteger>{});
+      break;
+  }
+}
+
+BuiltinProcessingCall MakeBinaryCall(BinaryOp op) {
+  return [op](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (outputs.empty() || !outputs[0]) {
+      return;
+    }
+    auto& out = *outputs[0];
+    if (!HasValueInputs(inputs, outputs, 2, out.signature.encoding)) {
+      return;
+    }
+    ForEncoding(out.signature.encoding, [&]<class DataClass>(std::type_identity<DataClass>) {
+      auto const n = out.signature.array_length;
+      auto const m = out.signature.num_coords;
+      auto const a = Gather<DataClass>(inputs[0], n, m);
+      auto const b = Gather<DataClass>(inputs[1], n, m);
+      auto result = Column<DataClass>(a.size());
+      ApplyBinary(op, a.data(), b.data(), result.data(), result.size());
+      Scatter<DataClass>(result, out);
+    });
+  };
+}
+
+BuiltinProcessingCall MakeClampCall() {
+  return [](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (outputs.empty() || !outputs[0]) {
+      return;
+    }
+    auto& out = *outputs[0];
+    if (!HasValueInputs(inputs, outputs, 3, out.signature.encoding)) {
+      return;
+    }
+    ForEncoding(out.signature.encoding, [&]<class DataClass>(std::type_identity<DataClass>) {
+      auto const n = out.signature.array_length;
+      auto const m = out.signature.num_coords;
+      auto const x = Gather<DataClass>(inputs[0], n, m);
+      auto const low = Gather<DataClass>(inputs[1], n, m);
+      auto const high = Gather<DataClass>(inputs[2], n, m);
+      auto result = Column<DataClass>(x.size());
+      Clamp(x.data(), low.data(), high.data(), result.data(), result.size());
+      Scatter<DataClass>(result, out);
+    });
+  };
+}
+
+BuiltinProcessingCall MakeMixCall() {
+  return [](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (!HasValueInputs(inputs, outputs, 3, Encoding::floating) ||
+        outputs[0]->signature.encoding != Encoding::floating) {
+      return;
+    }
+    auto& out = *outputs[0];
+    auto const n = out.signature.array_length;
+    auto const m = out.signature.num_coords;
+    auto const a = Gather<Floating>(inputs[0], n, m);
+    auto const b = Gather<Floating>(inputs[1], n, m);
+    auto const t = Gather<Floating>(inputs[2], n, m);
+    auto result = Column<Floating>(a.size());
+    Mix(a.data(), b.data(), t.data(), result.data(), result.size());
+    Scatter<Floating>(result, out);
+  };
+}
+
+BuiltinProcessingCall MakeRemapCall() {
+  return [](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (!HasValueInputs(inputs, outputs, 5, Encoding::floating) ||
+        outputs[0]->signature.encoding != Encoding::floating) {
+      return;
+    }
+    auto& out = *outputs[0];
+    auto const n = out.signature.array_length;
+    auto const m = out.signature.num_coords;
+    auto const x = Gather<Floating>(inputs[0], n, m);
+    auto const in_min = Gather<Floating>(inputs[1], n, m);
+    auto const in_max = Gather<Floating>(inputs[2], n, m);
+    auto const out_min = Gather<Floating>(inputs[3], n, m);
+    auto const out_max = Gather<Floating>(inputs[4], n, m);
+    auto result = Column<Floating>(x.size());
+    Remap(x.data(), in_min.data(), in_max.data(), out_min.data(), out_max.data(), result.data(), result.size());
+    Scatter<Floating>(result, out);
+  };
+}
+
+BuiltinProcessingCall MakeReduceCall(Reduction reduction) {
+  return [reduction](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (outputs.empty() || !outputs[0]) {
+      return;
+    }
+    auto& out = *outputs[0];
+    if (!HasValueInputs(inputs, outputs, 1, out.signature.encoding)) {
+      return;
+    }
+    ForEncoding(out.signature.encoding, [&]<class DataClass>(std::type_identity<DataClass>) {
+      auto const n = inputs[0].signature.array_length;
+      auto const m = out.signature.num_coords;
+      auto const x = Gather<DataClass>(inputs[0], n, m);
+      // one column per coordinate, reduced to an array of length one and broadcast to the output
+      auto result = Column<DataClass>(size_t(out.signature.array_length) * m);
+      for (uint32_t c = 0; c < m; ++c) {
+        auto const begin = result.begin() + size_t(c) * out.signature.array_length;
+        std::fill(begin, begin + out.signature.array_length, Reduce(reduction, x.data() + size_t(c) * n, n));
+      }
+      Scatter<DataClass>(result, out);
+    });
+  };
+}
+
+BuiltinProcessingCall MakePrefixSumCall() {
+  return [](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (outputs.empty() || !outputs[0]) {
+      return;
+    }
+    auto& out = *outputs[0];
+    if (!HasValueInputs(inputs, outputs, 1, out.signature.encoding)) {
+      return;
+    }
+    ForEncoding(out.signature.encoding, [&]<class DataClass>(std::type_identity<DataClass>) {
+      auto const n = out.signature.array_length;
+      auto const m = out.signature.num_coords;
+      auto const x = Gather<DataClass>(inputs[0], n, m);
+      auto result = Column<DataClass>(x.size());
+      for (uint32_t c = 0; c < m; ++c) {
+        PrefixSum(x.data() + size_t(c) * n, result.data() + size_t(c) * n, n);
+      }
+      Scatter<DataClass>(result, out);
+    });
+  };
+}
+
+BuiltinProcessingCall MakeSortCall() {
+  return [](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (outputs.empty() || !outputs[0]) {
+      return;
+    }
+    auto& out = *outputs[0];
+    if (!HasValueInputs(inputs, outputs, 1, out.signature.encoding)) {
+      return;
+    }
+    ForEncoding(out.signature.encoding, [&]<class DataClass>(std::type_identity<DataClass>) {
+      auto const n = out.signature.array_length;
+      auto const m = out.signature.num_coords;
+      auto x = Gather<DataClass>(inputs[0], n, m);
+      for (uint32_t c = 0; c < m; ++c) {
+        Sort(x.data() + size_t(c) * n, n);
+      }
+      Scatter<DataClass>(x, out);
+    });
+  };
+}
+
+BuiltinProcessingCall MakeHistogramCall() {
+  return [](std::vector<Input> const& inputs, std::vector<std::unique_ptr<Data>>& outputs) {
+    if (!HasValueInputs(inputs, outputs, 3, Encoding::floating) ||
+        outputs[0]->signature.encoding != Encoding::uinteger) {
+      return;
+    }
+    auto& out = *outputs[0];
+    auto const x = Gather<Floating>(inputs[0], inputs[0].signature.array_length, inputs[0].signature.num_coords);
+    auto const min = inputs[1].GetView<Floating>()(0, 0);
+    auto const max = inputs[2].GetView<Floating>()(0, 0);
+    auto const num_bins = out.signature.array_length;
+    auto bins = Column<UInteger>(num_bins);
+    Histogram(x.data(), x.size(), min, max, bins.data(), num_bins);
+    // the counts in every coordinate of the output
+    auto result = Column<UInteger>(size_t(num_bins) * out.signature.num_coords);
+    for (uint32_t c = 0; c < out.signature.num_coords; ++c) {
+      std::copy(bins.begin(), bins.end(), result.begin() + size_t(c) * num_bins);
+    }
+    Scatter<UInteger>(result, out);
+  };
+}
@@ -0,0 +1,51 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+
+// CPU kernels over contiguous arrays of float, int32_t or uint32_t. Their loops are kept simple so that compilers
+// vectorize them, and arrays of at least kernel_parallel_threshold elements are split in chunks across the ThreadPool.
+// Outputs must not alias inputs.
+constexpr inline size_t kernel_parallel_threshold = size_t(1) << 16;
+constexpr inline size_t kernel_chunk_size = size_t(1) << 14;
+
+enum class BinaryOp { add, subtract, multiply, divide, min, max };
+enum class Reduction { sum, min, max, mean };
+
+template<class T>
+void ApplyBinary(BinaryOp op, T const* a, T const* b, T* out, size_t count); // integer division by zero gives 0
+template<class T>
+void Clamp(T const* x, T const* low, T const* high, T* out, size_t count);
+void Mix(float const* a, float const* b, float const* t, float* out, size_t count);
+void Remap(float const* x,
+           float const* in_min,
+           float const* in_max,
+           float const* out_min,
+           float const* out_max,
+           float* out,
+           size_t count);
+template<class T>
+T Reduce(Reduction reduction, T const* x, size_t count);
+template<class T>
+void PrefixSum(T const* x, T* out, size_t count); // inclusive
+template<class T>
+void Sort(T* x, size_t count);
+// values outside of [min, max) and NaNs are not counted
+void Histogram(float const* x, size_t count, float min, float max, uint32_t* bins, uint32_t num_bins);
+
+// Processing calls for BuiltinProcessor, working in the encoding of their first output, which their value inputs must
+// share. Inputs of array length or number of coordinates one are broadcast, and each coordinate is processed as an
+// array of its own.
+BuiltinProcessingCall MakeBinaryCall(BinaryOp op);        // a, b
+BuiltinProcessingCall MakeClampCall();                     // x, low, high
+BuiltinProcessingCall MakeMixCall();                       // a, b, t, floating only
+BuiltinProcessingCall MakeRemapCall();                     // x, in min, in max, out min, out max, floating only
+BuiltinProcessingCall MakeReduceCall(Reduction reduction); // x, into an output of array length one
+BuiltinProcessingCall MakePrefixSumCall();                 // x
+BuiltinProcessingCall MakeSortCall();                      // x
+BuiltinProcessingCall MakeHistogramCall(); // x, min, max, floating, into uinteger bins, one per output array element
@@ -0,0 +1,167 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "curve_lut.h"
+#include "gpu_memory.h"
+#include <algorithm>
+
+static float GetSlope(std::array<float, 2> const& tangent) {
+  // vertical and backwards tangents are flattened, so that the curve stays a function of x
+  return tangent[0] > 0.f ? tangent[1] / tangent[0] : 0.f;
+}
+
+float EvaluateCurve(CurvePoints const& curve, float x) {
+  auto const& points = curve.points;
+  if (points.empty()) {
+    return 0.f;
+  }
+  if (!(x > points.front().position[0])) {
+    return points.front().position[1];
+  }
+  if (x >= points.back().position[0]) {
+    return points.back().position[1];
+  }
+  auto const next = std::upper_bound(
+    points.begin(), points.end(), x, [](float x, CurvePoint const& point) { return x < point.position[0]; });
+  auto const& p0 = *(next - 1);
+  auto const& p1 = *next;
+  auto const width = p1.position[0] - p0.position[0];
+  if (width <= 0.f) {
+    return p1.position[1];
+  }
+  auto const t = (x - p0.position[0]) / width;
+  auto const u = 1.f - t;
+  auto const y0 = p0.position[1];
+  auto const y1 = p0.position[1] + GetSlope(p0.tangent_right) * width / 3.f;
+  auto const y2 = p1.position[1] - GetSlope(p1.tangent_left) * width / 3.f;
+  auto const y3 = p1.position[1];
+  return u * u * u * y0 + 3.f * u * u * t * y1 + 3.f * u * t * t * y2 + t * t * t * y3;
+}
+
+CurveLut::CurveLut(CurvePoints const& curve, uint32_t resolution) {
+  if (!curve.points.empty()) {
+    min_x = curve.points.front().position[0];
+    max_x = std::max(curve.points.back().position[0], min_x);
+  }
+  samples.resize(std::max(resolution, 2u));
+  auto const last = float(samples.size() - 1);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = EvaluateCurve(curve, min_x + (max_x - min_x) * (float(i) / last));
+  }
+  scale = max_x > min_x ? last / (max_x - min_x) : 0.f;
+}
+
+float CurveLut::Evaluate(float x) const {
+  auto y = 0.f;
+  Evaluate(&x, &y, 1);
+  return y;
+}
+
+// __restrict and separate pointers to the two samples to interpolate let compilers use gathers
+static void EvaluateLut(float const* __restrict x,
+                        float* __restrict y,
+                        size_t count,
+                        float const* __restrict samples,
+                        float const* __restrict next_samples,
+                        int32_t max_index,
+                        float offset,
+                        float scale) {
+  auto const last = float(max_index + 1);
+  for (size_t i = 0; i < count; ++i) {
+    auto position = (x[i] - offset) * scale;
+    // ternaries rather than std::min and std::max, which take references. NaN ends up at the start of the curve
+    position = position > 0.f ? position : 0.f;
+    position = position < last ? position : last;
+    auto const truncated = int32_t(position);
+    auto const index = truncated < max_index ? truncated : max_index;
+    auto const fraction = position - float(index);
+    auto const a = samples[index];
+    auto const b = next_samples[index];
+    y[i] = a + (b - a) * fraction;
+  }
+}
+
+void CurveLut::Evaluate(float const* x, float* y, size_t count) const {
+  auto const s = samples.data();
+  EvaluateLut(x, y, count, s, s + 1, int32_t(samples.size()) - 2, min_x, scale);
+}
+
+size_t CurveLuts::KeyHash::operator()(Key const& key) const {
+  return std::hash<uint64_t>{}(key.version ^ (uint64_t(key.array_index) << 48) ^ (uint64_t(key.coord) << 32));
+}
+
+CurveLuts& CurveLuts::Get() {
+  static CurveLuts luts{};
+  return luts;
+}
+
+CurveLuts::CurveLuts() {
+  App::Get().onNewFrame.push_back([this] { BeginFrame(); });
+}
+
+void CurveLuts::BeginFrame() {
+  auto lock = std::lock_guard(mutex);
+  ++frame;
+  std::erase_if(entries, [&](auto const& entry) { return entry.second.frame + max_unused_frames < frame; });
+}
+
+void CurveLuts::SetResolution(uint32_t resolution) {
+  auto lock = std::lock_guard(mutex);
+  if (this->resolution != resolution) {
+    this->resolution = resolution;
+    entries.clear();
+  }
+}
+
+CurveLuts::Entry* CurveLuts::GetEntry(Curve const& curve, uint32_t array_index, uint32_t coord) {
+  if (array_index >= curve.data.size() || coord >= curve.data[array_index].size()) {
+    return nullptr;
+  }
+  auto& entry = entries[{ curve.version, array_index, coord }];
+  if (!entry.lut) {
+    entry.lut = std::make_shared<CurveLut const>(curve.data[array_index][coord], resolution);
+  }
+  entry.frame = frame;
+  return &entry;
+}
+
+std::shared_ptr<CurveLut const> CurveLuts::GetLut(Curve const& curve, uint32_t array_index, uint32_t coord) {
+  auto lock = std::lock_guard(mutex);
+  auto entry = GetEntry(curve, array_index, coord);
+  return entry ? entry->lut : nullptr;
+}
+
+TextureRef CurveLuts::GetTexture(ProcessorId owner, Curve const& curve, uint32_t array_index, uint32_t coord) {
+  auto lock = std::lock_guard(mutex);
+  auto entry = GetEntry(curve, array_index, coord);
+  if (!entry) {
+    return nullptr;
+  }
+  if (entry->texture) {
+    return entry->texture;
+  }
+  auto const& samples = entry->lut->GetSamples();
+  wgpu::TextureDescriptor desc = wgpu::Default;
+  desc.label = { "Curve LUT", WGPU_STRLEN };
+  desc.dimension = wgpu::TextureDimension::_1D;
+  desc.size.width = uint32_t(samples.size());
+  desc.size.height = 1;
+  desc.size.depthOrArrayLayers = 1;
+  desc.format = wgpu::TextureFormat::R32Float;
+  desc.usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst;
+  desc.mipLevelCount = 1;
+  desc.sampleCount = 1;
+  entry->texture = GpuMemory::Get().AllocateTexture(owner, desc);
+
+  wgpu::TexelCopyTextureInfo destination = wgpu::Default;
+  destination.texture = **entry->texture;
+  wgpu::TexelCopyBufferLayout layout = wgpu::Default;
+  layout.offset = 0;
+  layout.bytesPerRow = uint32_t(samples.size() * sizeof(float));
+  layout.rowsPerImage = 1;
+  GpuQueue().writeTexture(destination, samples.data(), samples.size() * sizeof(float), layout, desc.size);
+  return entry->texture;
+}
@@ -0,0 +1,83 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <mutex>
+#include <unordered_map>
+
+// Evaluates a curve as a function of x. The points are sorted by x, and each segment is a cubic Bézier whose handles
+// follow the tangents and are a third of the segment wide, so that x is linear in the Bézier parameter. Outside of the
+// points the curve is constant.
+float EvaluateCurve(CurvePoints const& curve, float x);
+
+// A curve baked into uniformly spaced samples over the x range of its points, evaluated with linear interpolation.
+class CurveLut final {
+public:
+  static constexpr uint32_t default_resolution = 1024;
+
+  explicit CurveLut(CurvePoints const& curve, uint32_t resolution = default_resolution);
+
+  float Evaluate(float x) const;
+  // branch free, written so that compilers vectorize it
+  void Evaluate(float const* x, float* y, size_t count) const;
+
+  std::vector<float> const& GetSamples() const { return samples; }
+  float GetMinX() const { return min_x; }
+  float GetMaxX() const { return max_x; }
+
+private:
+  std::vector<float> samples;
+  float min_x = 0.f;
+  float max_x = 1.f;
+  float scale = 0.f; // from x to sample position
+};
+
+// Bakes the curves of Curve data on demand, and keeps each LUT until the version of its data changes or it goes unused
+// for a while. Safe to use from concurrent evaluations.
+class CurveLuts final {
+public:
+  static CurveLuts& Get();
+
+  void SetResolution(uint32_t resolution);
+  uint32_t GetResolution() const { return resolution; }
+
+  std::shared_ptr<CurveLut const> GetLut(Curve const& curve, uint32_t array_index = 0, uint32_t coord = 0);
+  // The LUT as a 1D R32Float texture. It is not filterable, so shaders read it with textureLoad and interpolate.
+  TextureRef GetTexture(ProcessorId owner, Curve const& curve, uint32_t array_index = 0, uint32_t coord = 0);
+
+private:
+  CurveLuts();
+
+  struct Key {
+    uint64_t version = 0;
+    uint32_t array_index = 0;
+    uint32_t coord = 0;
+
+    bool operator==(Key const&) const = default;
+  };
+
+  struct KeyHash {
+    size_t operator()(Key const& key) const;
+  };
+
+  struct Entry {
+    std::shared_ptr<CurveLut const> lut;
+    TextureRef texture;
+    uint64_t frame = 0;
+  };
+
+  void BeginFrame();
+  Entry* GetEntry(Curve const& curve, uint32_t array_index, uint32_t coord);
+
+  static constexpr uint64_t max_unused_frames = 60;
+
+  std::mutex mutex;
+  std::unordered_map<Key, Entry, KeyHash> entries;
+  uint32_t resolution = CurveLut::default_resolution;
+  uint64_t frame = 0;
+};
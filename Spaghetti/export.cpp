@@ -0,0 +1,274 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "export.h"
+#include "frame_range.h"
+#include "stb_image_write.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static float HalfToFloat(uint16_t half) {
+  uint32_t const sign = uint32_t(half & 0x8000) << 16;
+  uint32_t const exponent = (half >> 10) & 0x1f;
+  uint32_t const mantissa = half & 0x3ff;
+  if (exponent == 0) {
+    auto const value = std::ldexp(float(mantissa), -24);
+    return sign ? -value : value;
+  }
+  uint32_t const bits = exponent == 31 ? sign | 0x7f800000 | (mantissa << 13)
+                                       : sign | ((exponent + 112) << 23) | (mantissa << 13);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static bool IsRgba8(wgpu::TextureFormat format) {
+  return format == wgpu::TextureFormat::RGBA8Unorm || format == wgpu::TextureFormat::RGBA8UnormSrgb;
+}
+
+static bool IsBgra8(wgpu::TextureFormat format) {
+  return format == wgpu::TextureFormat::BGRA8Unorm || format == wgpu::TextureFormat::BGRA8UnormSrgb;
+}
+
+// the readback rows are padded, the decoded images are tightly packed RGBA
+static bool DecodeFloat(ReadbackData const& data, std::vector<float>& rgba) {
+  auto const width = size_t(data.width);
+  rgba.resize(width * data.height * 4);
+  for (uint32_t y = 0; y < data.height; ++y) {
+    auto const row = data.bytes.data() + size_t(y) * data.bytes_per_row;
+    auto const out = rgba.data() + y * width * 4;
+    if (IsRgba8(data.format)) {
+      for (size_t i = 0; i < width * 4; ++i) {
+        out[i] = float(row[i]) / 255.f;
+      }
+    }
+    else if (IsBgra8(data.format)) {
+      for (size_t x = 0; x < width; ++x) {
+        out[4 * x + 0] = float(row[4 * x + 2]) / 255.f;
+        out[4 * x + 1] = float(row[4 * x + 1]) / 255.f;
+        out[4 * x + 2] = float(row[4 * x + 0]) / 255.f;
+        out[4 * x + 3] = float(row[4 * x + 3]) / 255.f;
+      }
+    }
+    else if (data.format == wgpu::TextureFormat::RGBA16Float) {
+      for (size_t i = 0; i < width * 4; ++i) {
+        uint16_t half;
+        std::memcpy(&half, row + 2 * i, sizeof(half));
+        out[i] = HalfToFloat(half);
+      }
+    }
+    else if (data.format == wgpu::TextureFormat::RGBA32Float) {
+      std::memcpy(out, row, width * 4 * sizeof(float));
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool DecodeRgba8(ReadbackData const& data, std::vector<uint8_t>& rgba) {
+  auto const width = size_t(data.width);
+  if (IsRgba8(data.format) || IsBgra8(data.format)) {
+    rgba.resize(width * data.height * 4);
+    for (uint32_t y = 0; y < data.height; ++y) {
+      auto const row = data.bytes.data() + size_t(y) * data.bytes_per_row;
+      auto const out = rgba.data() + y * width * 4;
+      std::memcpy(out, row, width * 4);
+      if (IsBgra8(data.format)) {
+        for (size_t x = 0; x < width; ++x) {
+          std::swap(out[4 * x], out[4 * x + 2]);
+        }
+      }
+    }
+    return true;
+  }
+  std::vector<float> decoded;
+  if (!DecodeFloat(data, decoded)) {
+    return false;
+  }
+  rgba.resize(decoded.size());
+  for (size_t i = 0; i < decoded.size(); ++i) {
+    rgba[i] = uint8_t(std::clamp(decoded[i], 0.f, 1.f) * 255.f + 0.5f);
+  }
+  return true;
+}
+
+static char const* GetExtension(ExportFormat format) {
+  switch (format) {
+    case ExportFormat::png:
+      return ".png";
+    case ExportFormat::float_dump:
+      return ".rgbaf";
+    case ExportFormat::pam:
+      return ".pam";
+  }
+  return "";
+}
+
+BatchExport::BatchExport(ExportSettings settings, std::vector<DataAddress> sinks)
+  : settings{ std::move(settings) }
+  , sinks{ std::move(sinks) } {}
+
+BatchExport::~BatchExport() {
+  // encoding tasks reference this
+  Finish();
+}
+
+bool BatchExport::Run(Graph& graph, std::function<void(int64_t frame)> const& set_frame) {
+  auto error = std::error_code{};
+  std::filesystem::create_directories(settings.directory, error);
+  if (error) {
+    return false;
+  }
+  for (auto frame = settings.first_frame; frame <= settings.last_frame; ++frame) {
+    set_frame(frame);
+    graph.Execute();
+    Submit(frame);
+    Pump();
+  }
+  Finish();
+  return num_failed == 0;
+}
+
+bool BatchExport::Run(FrameRangeEvaluator& frames) {
+  auto error = std::error_code{};
+  std::filesystem::create_directories(settings.directory, error);
+  if (error) {
+    return false;
+  }
+  auto const evaluated = frames.Run(settings.first_frame, settings.last_frame, [this](int64_t frame) {
+    Submit(frame);
+    Pump();
+  });
+  Finish();
+  return evaluated && num_failed == 0;
+}
+
+void BatchExport::Submit(int64_t frame) {
+  for (auto const& sink : sinks) {
+    auto p = Processor::Get(sink.processor);
+    if (!p || sink.data_index >= p->GetOutputs().size()) {
+      ++num_failed;
+      continue;
+    }
+    auto const out = p->GetOutputs()[sink.data_index].get();
+    if (!out || out->signature.type != Type::image) {
+      ++num_failed;
+      continue;
+    }
+    auto const& textures = static_cast<Image const*>(out)->data;
+    for (size_t layer = 0; layer < textures.size(); ++layer) {
+      auto const& texture = textures[layer];
+      auto const bytes = texture && *texture ? uint64_t((*texture)->getWidth()) * (*texture)->getHeight() *
+                                                 BytesPerTexel((*texture)->getFormat())
+                                             : 0;
+      WaitForMemory(bytes);
+      in_flight_bytes += bytes;
+      pending.push_back({ ReadbackRing::Get().Read(texture), GetPath(sink, layer, frame), bytes });
+    }
+  }
+}
+
+void BatchExport::Pump() {
+  auto const ready = std::partition(
+    pending.begin(), pending.end(), [](Pending const& pending) { return !pending.readback->ready; });
+  for (auto it = ready; it != pending.end(); ++it) {
+    ++num_encoding;
+    ThreadPool::Get().Submit([this, encoding = std::move(*it)] {
+      if (!Encode(encoding)) {
+        ++num_failed;
+      }
+      in_flight_bytes -= encoding.bytes;
+      --num_encoding;
+    });
+  }
+  pending.erase(ready, pending.end());
+}
+
+void BatchExport::Finish() {
+  while (!pending.empty() || num_encoding > 0) {
+    ReadbackRing::Get().Pump();
+    Pump();
+    WaitForEncoders();
+  }
+}
+
+void BatchExport::WaitForMemory(uint64_t bytes) {
+  // a single image larger than the bound is let through once everything else is done
+  while (in_flight_bytes > 0 && in_flight_bytes + bytes > settings.max_in_flight_bytes) {
+    ReadbackRing::Get().Pump();
+    Pump();
+    WaitForEncoders();
+  }
+}
+
+void BatchExport::WaitForEncoders() {
+  // the workers may all be busy evaluating frames, so help rather than sleep
+  if (!ThreadPool::Get().RunPendingTask()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+std::filesystem::path BatchExport::GetPath(DataAddress sink, size_t layer, int64_t frame) const {
+  char name[128];
+  snprintf(name,
+           sizeof(name),
+           "_%llu_%u_%zu_%06lld",
+           (unsigned long long)sink.processor,
+           sink.data_index,
+           layer,
+           (long long)frame);
+  return settings.directory / (settings.prefix + name + GetExtension(settings.format));
+}
+
+bool BatchExport::Encode(Pending const& pending) const {
+  auto const& data = *pending.readback;
+  if (data.failed || data.width == 0 || data.height == 0) {
+    return false;
+  }
+  auto const width = int(data.width);
+  auto const height = int(data.height);
+  switch (settings.format) {
+    case ExportFormat::png: {
+      if (IsRgba8(data.format)) {
+        return stbi_write_png(pending.path.string().c_str(), width, height, 4, data.bytes.data(), data.bytes_per_row);
+      }
+      auto rgba = std::vector<uint8_t>{};
+      if (!DecodeRgba8(data, rgba)) {
+        return false;
+      }
+      return stbi_write_png(pending.path.string().c_str(), width, height, 4, rgba.data(), width * 4);
+    }
+    case ExportFormat::pam: {
+      auto rgba = std::vector<uint8_t>{};
+      if (!DecodeRgba8(data, rgba)) {
+        return false;
+      }
+      auto file = std::ofstream(pending.path, std::ios::binary);
+      file << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+      file.write(reinterpret_cast<char const*>(rgba.data()), std::streamsize(rgba.size()));
+      return bool(file);
+    }
+    case ExportFormat::float_dump: {
+      auto rgba = std::vector<float>{};
+      if (!DecodeFloat(data, rgba)) {
+        return false;
+      }
+      uint32_t const header[4] = { 0x46475053, data.width, data.height, 4 }; // "SPGF" little endian
+      auto file = std::ofstream(pending.path, std::ios::binary);
+      file.write(reinterpret_cast<char const*>(header), sizeof(header));
+      file.write(reinterpret_cast<char const*>(rgba.data()), std::streamsize(rgba.size() * sizeof(float)));
+      return bool(file);
+    }
+  }
+  return false;
+}
@@ -0,0 +1,67 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <atomic>
+#include <filesystem>
+
+class FrameRangeEvaluator;
+
+enum class ExportFormat {
+  png,        // 8 bits per channel
+  float_dump, // 32 bit float RGBA after a 16 byte header: "SPGF", width, height, channels
+  pam,        // 8 bits per channel, uncompressed Netpbm PAM, the cheapest to encode
+};
+
+struct ExportSettings {
+  std::filesystem::path directory;
+  std::string prefix = "frame";
+  ExportFormat format = ExportFormat::png;
+  int64_t first_frame = 0;
+  int64_t last_frame = 0;
+  uint64_t max_in_flight_bytes = uint64_t(512) << 20;
+};
+
+// Exports the images of some sink outputs over a range of frames. Each frame is read back asynchronously and encoded
+// on the ThreadPool, one file per task, while the next frames are evaluated. Memory held by readbacks and encoders is
+// bounded by max_in_flight_bytes.
+class BatchExport final {
+public:
+  BatchExport(ExportSettings settings, std::vector<DataAddress> sinks);
+  ~BatchExport();
+
+  BatchExport(const BatchExport&) = delete;
+  BatchExport& operator=(const BatchExport&) = delete;
+
+  bool Run(Graph& graph, std::function<void(int64_t frame)> const& set_frame);
+  // evaluates several frames at once, on the ThreadPool
+  bool Run(FrameRangeEvaluator& frames);
+  void Submit(int64_t frame);
+  void Pump();
+  void Finish();
+  size_t GetNumFailed() const { return num_failed; }
+
+private:
+  struct Pending {
+    ReadbackFuture readback;
+    std::filesystem::path path;
+    uint64_t bytes = 0;
+  };
+
+  void WaitForMemory(uint64_t bytes);
+  void WaitForEncoders();
+  bool Encode(Pending const& pending) const;
+  std::filesystem::path GetPath(DataAddress sink, size_t layer, int64_t frame) const;
+
+  ExportSettings settings;
+  std::vector<DataAddress> sinks;
+  std::vector<Pending> pending;
+  std::atomic<uint64_t> in_flight_bytes{ 0 };
+  std::atomic<size_t> num_encoding{ 0 };
+  std::atomic<size_t> num_failed{ 0 };
+};
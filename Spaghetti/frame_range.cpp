@@ -0,0 +1,277 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "frame_range.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+std::vector<std::unique_ptr<Data>>* EvaluationState::FindOutputs(ProcessorId processor) {
+  auto it = outputs.find(processor);
+  if (it != outputs.end()) {
+    return &it->second;
+  }
+  return shared ? shared->FindOutputs(processor) : nullptr;
+}
+
+Data* EvaluationState::FindConverted(Input const* input) {
+  auto it = converted.find(input);
+  if (it != converted.end()) {
+    return it->second.get();
+  }
+  return shared ? shared->FindConverted(input) : nullptr;
+}
+
+std::vector<ReadbackFuture> const* EvaluationState::FindReadbacks(ProcessorId processor, uint32_t input_index) {
+  auto it = readbacks.find(processor);
+  if (it != readbacks.end() && input_index < it->second.size()) {
+    return &it->second[input_index];
+  }
+  return nullptr;
+}
+
+FrameRangeEvaluator::FrameRangeEvaluator(FrameRangeSettings settings)
+  : settings{ settings } {}
+
+bool FrameRangeEvaluator::Prepare() {
+  order.clear();
+  constants.outputs.clear();
+
+  auto source = Processor::Get(settings.time_source.processor);
+  if (!source || settings.time_source.data_index >= source->GetOutputs().size()) {
+    return false;
+  }
+  auto const& time = source->GetOutputs()[settings.time_source.data_index];
+  if (!time || time->signature.type != Type::value || time->signature.encoding != Encoding::floating) {
+    return false;
+  }
+
+  // everything reachable from the time source depends on the frame
+  std::unordered_set<Processor*> dependent{ source };
+  std::vector<Processor*> to_visit{ source };
+  while (!to_visit.empty()) {
+    auto p = to_visit.back();
+    to_visit.pop_back();
+    for (auto const& out_clients : p->GetOutputLinks()) {
+      for (auto client : out_clients.second) {
+        auto c = Processor::Get(client.processor);
+        if (c && dependent.insert(c).second) {
+          to_visit.push_back(c);
+        }
+      }
+    }
+  }
+
+  // links from outside of the subgraph read constant outputs, which are snapshotted
+  std::unordered_map<Processor*, size_t> num_dependencies;
+  for (auto p : dependent) {
+    auto& n = num_dependencies[p];
+    for (auto const& in : p->GetInputs()) {
+      auto linked = Processor::Get(in.linkedOutput.processor);
+      if (!linked) {
+        continue;
+      }
+      if (in.link_type == LinkType::previous_frame) {
+        // frames are evaluated concurrently and out of order, so there is no previous frame to read
+        return false;
+      }
+      if (dependent.find(linked) != dependent.end()) {
+        ++n;
+        continue;
+      }
+      if (constants.outputs.find(linked->id) != constants.outputs.end()) {
+        continue;
+      }
+      if (linked->IsEvicted()) {
+        // its outputs are gone until the live graph regenerates them
+        return false;
+      }
+      auto& snapshot = constants.outputs[linked->id];
+      for (auto const& out : linked->GetOutputs()) {
+        snapshot.push_back(out ? out->Clone() : nullptr);
+      }
+    }
+  }
+
+  std::vector<Processor*> ready{ source };
+  size_t num_sorted = 0;
+  while (!ready.empty()) {
+    auto p = ready.back();
+    ready.pop_back();
+    ++num_sorted;
+    if (p != source) {
+      order.push_back(p);
+    }
+    for (auto const& out_clients : p->GetOutputLinks()) {
+      for (auto client : out_clients.second) {
+        auto c = Processor::Get(client.processor);
+        if (c && --num_dependencies[c] == 0) {
+          ready.push_back(c);
+        }
+      }
+    }
+  }
+  // a cycle through the time source
+  return num_sorted == dependent.size();
+}
+
+std::unique_ptr<EvaluationState> FrameRangeEvaluator::MakeState() {
+  auto state = std::make_unique<EvaluationState>();
+  state->shared = &constants;
+  auto& time_outputs = state->outputs[settings.time_source.processor];
+  for (auto const& out : Processor::Get(settings.time_source.processor)->GetOutputs()) {
+    time_outputs.push_back(out ? out->Clone() : nullptr);
+  }
+  // each state renders into its own GPU resources, allocated by the processors on their first run
+  for (auto p : order) {
+    auto& outputs = state->outputs[p->id];
+    for (auto const& out : p->GetOutputs()) {
+      outputs.push_back(out ? out->Clone() : nullptr);
+      if (outputs.back()) {
+        ReleaseGpuResources(*outputs.back());
+      }
+    }
+  }
+  return state;
+}
+
+void FrameRangeEvaluator::UpdateConversions(Processor const* p, EvaluationState& state) {
+  for (auto const& in : p->GetInputs()) {
+    auto linked = Processor::Get(in.linkedOutput.processor);
+    if (!linked) {
+      continue;
+    }
+    auto const& linked_outputs = linked->GetOutputs();
+    auto data = in.linkedOutput.data_index < linked_outputs.size() ? linked_outputs[in.linkedOutput.data_index].get()
+                                                                    : nullptr;
+    if (!data || data->signature == in.signature) {
+      state.converted.erase(&in);
+      continue;
+    }
+    state.converted[&in] = data->ConvertTo(in.signature);
+  }
+}
+
+void FrameRangeEvaluator::ReadBack(Processor const* p, EvaluationState& state) {
+  auto& futures = state.readbacks[p->id];
+  futures.clear();
+  for (auto const& in : p->GetInputs()) {
+    auto data = in.GetInputData();
+    futures.push_back(data ? ReadBackData(*data) : std::vector<ReadbackFuture>{});
+  }
+  // with gpu_mutex held nothing else is queued, so this only waits on the copies just recorded
+  for (auto const& input_futures : futures) {
+    for (auto const& future : input_futures) {
+      while (!future->ready) {
+        ReadbackRing::Get().Pump();
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+void FrameRangeEvaluator::Evaluate(EvaluationState& state, int64_t frame) {
+  auto binding = EvaluationState::Binding{ state };
+
+  auto& time = *state.outputs[settings.time_source.processor][settings.time_source.data_index];
+  auto const seconds = float(double(frame) / settings.frames_per_second);
+  for (auto& coords : static_cast<Floating&>(time).data) {
+    std::fill(coords.begin(), coords.end(), seconds);
+  }
+  time.Touch();
+
+  for (auto p : order) {
+    auto const serialized = p->RunsOnGpu() || p->ReadsGpuDataOnCpu();
+    auto lock = serialized ? std::unique_lock(gpu_mutex) : std::unique_lock<std::recursive_mutex>{};
+    UpdateConversions(p, state);
+    if (p->ReadsGpuDataOnCpu()) {
+      ReadBack(p, state);
+    }
+    p->Process();
+    for (auto& out : state.outputs[p->id]) {
+      if (out) {
+        out->Touch();
+      }
+    }
+  }
+}
+
+bool FrameRangeEvaluator::Run(int64_t first_frame,
+                              int64_t last_frame,
+                              std::function<void(int64_t frame)> const& on_frame) {
+  if (!Prepare()) {
+    return false;
+  }
+  if (last_frame < first_frame) {
+    return true;
+  }
+
+  auto& pool = ThreadPool::Get();
+  auto const num_frames = uint64_t(last_frame - first_frame) + 1;
+  auto const num_states = std::min<uint64_t>(num_frames, uint64_t(pool.GetNumThreads()) + 1);
+  std::vector<std::unique_ptr<EvaluationState>> states;
+  std::vector<EvaluationState*> free_states;
+  for (uint64_t i = 0; i < num_states; ++i) {
+    states.push_back(MakeState());
+    free_states.push_back(states.back().get());
+  }
+
+  struct Evaluated {
+    int64_t frame;
+    EvaluationState* state;
+  };
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<Evaluated> evaluated;
+  std::vector<Evaluated> to_consume;
+  auto next_frame = first_frame;
+  size_t num_running = 0;
+
+  while (next_frame <= last_frame || num_running > 0) {
+    // one task per frame, so that tasks queued by on_frame, like encoders, do not wait for the whole range
+    while (next_frame <= last_frame && !free_states.empty()) {
+      auto state = free_states.back();
+      free_states.pop_back();
+      ++num_running;
+      pool.Submit([&, state, frame = next_frame] {
+        Evaluate(*state, frame);
+        {
+          auto lock = std::lock_guard(mutex);
+          evaluated.push_back({ frame, state });
+        }
+        condition.notify_one();
+      });
+      ++next_frame;
+    }
+
+    while (true) {
+      {
+        auto lock = std::lock_guard(mutex);
+        to_consume.swap(evaluated);
+      }
+      if (!to_consume.empty()) {
+        break;
+      }
+      if (!pool.RunPendingTask()) {
+        auto lock = std::unique_lock(mutex);
+        condition.wait_for(lock, std::chrono::milliseconds(1), [&] { return !evaluated.empty(); });
+      }
+    }
+
+    for (auto const& e : to_consume) {
+      {
+        auto lock = std::lock_guard(gpu_mutex);
+        auto binding = EvaluationState::Binding{ *e.state };
+        on_frame(e.frame);
+      }
+      free_states.push_back(e.state);
+      --num_running;
+    }
+    to_consume.clear();
+  }
+  return true;
+}
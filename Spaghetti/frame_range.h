@@ -0,0 +1,78 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <mutex>
+#include <unordered_map>
+
+// The mutable data of an evaluation of the graph that runs alongside the live one. While bound to a thread, the
+// outputs, converted inputs and readbacks of the processors it holds are read from it instead of from the processors.
+class EvaluationState final {
+public:
+  static EvaluationState* GetCurrent() { return current; }
+
+  std::vector<std::unique_ptr<Data>>* FindOutputs(ProcessorId processor);
+  Data* FindConverted(Input const* input);
+  std::vector<ReadbackFuture> const* FindReadbacks(ProcessorId processor, uint32_t input_index);
+
+  class Binding final {
+  public:
+    explicit Binding(EvaluationState& state)
+      : previous{ current } {
+      current = &state;
+    }
+    ~Binding() { current = previous; }
+
+    Binding(const Binding&) = delete;
+    Binding& operator=(const Binding&) = delete;
+
+  private:
+    EvaluationState* previous;
+  };
+
+private:
+  friend class FrameRangeEvaluator;
+
+  EvaluationState* shared = nullptr; // read only, looked up after this
+  std::unordered_map<ProcessorId, std::vector<std::unique_ptr<Data>>> outputs;
+  std::unordered_map<Input const*, std::unique_ptr<Data>> converted;
+  std::unordered_map<ProcessorId, std::vector<std::vector<ReadbackFuture>>> readbacks;
+
+  static inline thread_local EvaluationState* current = nullptr;
+};
+
+struct FrameRangeSettings {
+  DataAddress time_source; // a floating value output, set to the time of each frame in seconds
+  double frames_per_second = 30.0;
+};
+
+// Evaluates the graph over a range of frames concurrently. Only the processors downstream of the time source depend on
+// the frame: each frame in flight evaluates them on its own EvaluationState, while the outputs of the processors they
+// read from outside of that subgraph are snapshotted once and shared by all frames.
+// CPU processors run in parallel. GPU work, readbacks and on_frame are serialized, as they go through a single queue.
+// on_frame is called on the calling thread, with the state of the frame bound, in no particular order of frames.
+// The live graph must have been executed before, so that the shared outputs are up to date.
+class FrameRangeEvaluator final {
+public:
+  explicit FrameRangeEvaluator(FrameRangeSettings settings);
+
+  bool Run(int64_t first_frame, int64_t last_frame, std::function<void(int64_t frame)> const& on_frame);
+
+private:
+  bool Prepare();
+  std::unique_ptr<EvaluationState> MakeState();
+  void Evaluate(EvaluationState& state, int64_t frame);
+  void UpdateConversions(Processor const* p, EvaluationState& state);
+  void ReadBack(Processor const* p, EvaluationState& state);
+
+  FrameRangeSettings settings;
+  std::vector<Processor*> order; // the processors that depend on the time source, sorted topologically
+  EvaluationState constants;
+  // reentrant, so that a thread holding it can run queued frames while it waits for the ThreadPool
+  std::recursive_mutex gpu_mutex;
+};
@@ -0,0 +1,182 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "gpu_memory.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdio>
+
+uint64_t GetTextureSize(wgpu::TextureDescriptor const& desc) {
+  uint64_t bytes = 0;
+  uint64_t width = desc.size.width;
+  uint64_t height = desc.size.height;
+  auto const mip_levels = std::max(desc.mipLevelCount, 1u);
+  for (uint32_t level = 0; level < mip_levels; ++level) {
+    bytes += width * height;
+    width = std::max<uint64_t>(width / 2, 1);
+    height = std::max<uint64_t>(height / 2, 1);
+  }
+  return bytes * std::max(desc.size.depthOrArrayLayers, 1u) * std::max(desc.sampleCount, 1u) *
+         BytesPerTexel(desc.format);
+}
+
+void GpuMemory::Accounting::Add(ProcessorId owner, uint64_t bytes, bool texture) {
+  auto lock = std::lock_guard(mutex);
+  total += bytes;
+  auto& u = usage[owner];
+  u.bytes += bytes;
+  if (texture) {
+    ++u.num_textures;
+  }
+  else {
+    ++u.num_buffers;
+  }
+}
+
+void GpuMemory::Accounting::Remove(ProcessorId owner, uint64_t bytes, bool texture) {
+  auto lock = std::lock_guard(mutex);
+  total -= bytes;
+  auto& u = usage[owner];
+  u.bytes -= bytes;
+  if (texture) {
+    --u.num_textures;
+  }
+  else {
+    --u.num_buffers;
+  }
+}
+
+GpuMemory& GpuMemory::Get() {
+  static GpuMemory memory{};
+  return memory;
+}
+
+GpuMemory::GpuMemory()
+  : accounting{ std::make_shared<Accounting>() } {}
+
+TextureRef GpuMemory::AllocateTexture(ProcessorId owner, wgpu::TextureDescriptor const& desc) {
+  auto const bytes = GetTextureSize(desc);
+  EnsureBudgetFor(bytes);
+  accounting->Add(owner, bytes, true);
+  return TextureRef(new wgpu::raii::Texture(Gpu().createTexture(desc)),
+                    [accounting = accounting, owner, bytes](wgpu::raii::Texture* texture) {
+                      (*texture)->destroy();
+                      delete texture;
+                      accounting->Remove(owner, bytes, true);
+                    });
+}
+
+BufferRef GpuMemory::AllocateBuffer(ProcessorId owner, wgpu::BufferDescriptor const& desc) {
+  auto const bytes = desc.size;
+  EnsureBudgetFor(bytes);
+  accounting->Add(owner, bytes, false);
+  return BufferRef(new wgpu::raii::Buffer(Gpu().createBuffer(desc)),
+                   [accounting = accounting, owner, bytes](wgpu::raii::Buffer* buffer) {
+                     (*buffer)->destroy();
+                     delete buffer;
+                     accounting->Remove(owner, bytes, false);
+                   });
+}
+
+void GpuMemory::MarkUsed(ProcessorId processor) {
+  auto lock = std::lock_guard(accounting->mutex);
+  accounting->usage[processor].last_used = ++tick;
+}
+
+void GpuMemory::SetBudget(uint64_t bytes) {
+  budget = bytes;
+  EnsureBudgetFor(0);
+}
+
+uint64_t GpuMemory::GetTotal() const {
+  auto lock = std::lock_guard(accounting->mutex);
+  return accounting->total;
+}
+
+std::unordered_map<ProcessorId, GpuMemoryUsage> GpuMemory::GetUsage() const {
+  auto lock = std::lock_guard(accounting->mutex);
+  return accounting->usage;
+}
+
+void GpuMemory::EnsureBudgetFor(uint64_t bytes) {
+  if (GetTotal() + bytes <= budget) {
+    return;
+  }
+  auto candidates = std::vector<std::pair<uint64_t, ProcessorId>>{};
+  for (auto const& [id, u] : GetUsage()) {
+    if (u.bytes > 0) {
+      candidates.push_back({ u.last_used, id });
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  for (auto const& [last_used, id] : candidates) {
+    if (GetTotal() + bytes <= budget) {
+      break;
+    }
+    auto p = Processor::Get(id);
+    if (p && p->CanEvict()) {
+      p->EvictGpuOutputs();
+    }
+  }
+}
+
+static std::string FormatBytes(uint64_t bytes) {
+  char text[32];
+  if (bytes >= (uint64_t(1) << 30)) {
+    snprintf(text, sizeof(text), "%.2f GiB", double(bytes) / double(uint64_t(1) << 30));
+  }
+  else if (bytes >= (uint64_t(1) << 20)) {
+    snprintf(text, sizeof(text), "%.2f MiB", double(bytes) / double(uint64_t(1) << 20));
+  }
+  else {
+    snprintf(text, sizeof(text), "%.2f KiB", double(bytes) / 1024.0);
+  }
+  return text;
+}
+
+void GpuMemory::DrawOverlay(bool* open) {
+  if (!ImGui::Begin("GPU Memory", open)) {
+    ImGui::End();
+    return;
+  }
+  auto budget_mib = int(budget >> 20);
+  if (ImGui::DragInt("Budget (MiB)", &budget_mib, 16.f, 64, 1 << 20)) {
+    SetBudget(uint64_t(budget_mib) << 20);
+  }
+  auto const total = GetTotal();
+  ImGui::ProgressBar(float(double(total) / double(budget)), ImVec2(-1.f, 0.f), FormatBytes(total).c_str());
+
+  auto usage = std::vector<std::pair<ProcessorId, GpuMemoryUsage>>{};
+  for (auto const& entry : GetUsage()) {
+    auto p = Processor::Get(entry.first);
+    if (entry.second.bytes > 0 || (p && p->IsEvicted())) {
+      usage.push_back(entry);
+    }
+  }
+  std::sort(usage.begin(), usage.end(), [](auto const& a, auto const& b) { return a.second.bytes > b.second.bytes; });
+
+  if (ImGui::BeginTable("Usage", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupColumn("Processor");
+    ImGui::TableSetupColumn("Memory");
+    ImGui::TableSetupColumn("Textures/Buffers");
+    ImGui::TableSetupColumn("State");
+    ImGui::TableHeadersRow();
+    for (auto const& [id, u] : usage) {
+      auto p = Processor::Get(id);
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(p && !p->display_name.empty() ? p->display_name.c_str() : "-");
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(FormatBytes(u.bytes).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%u/%u", u.num_textures, u.num_buffers);
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(p && p->IsEvicted() ? "evicted" : "resident");
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
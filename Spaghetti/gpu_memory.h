@@ -0,0 +1,60 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <mutex>
+#include <unordered_map>
+
+struct GpuMemoryUsage {
+  uint64_t bytes = 0;
+  uint32_t num_textures = 0;
+  uint32_t num_buffers = 0;
+  uint64_t last_used = 0;
+};
+
+// Accounts every texture and buffer a processor allocates against a budget. When an allocation would go over it, the
+// outputs of the least recently used processors that nobody is waiting on are released; such processors are
+// recomputed by Graph::Execute as soon as one of their clients needs them again.
+class GpuMemory final {
+public:
+  static GpuMemory& Get();
+
+  TextureRef AllocateTexture(ProcessorId owner, wgpu::TextureDescriptor const& desc);
+  BufferRef AllocateBuffer(ProcessorId owner, wgpu::BufferDescriptor const& desc);
+  void MarkUsed(ProcessorId processor);
+
+  void SetBudget(uint64_t bytes);
+  uint64_t GetBudget() const { return budget; }
+  uint64_t GetTotal() const;
+  std::unordered_map<ProcessorId, GpuMemoryUsage> GetUsage() const;
+
+  void DrawOverlay(bool* open);
+
+private:
+  GpuMemory();
+
+  struct Accounting {
+    std::mutex mutex;
+    uint64_t total = 0;
+    std::unordered_map<ProcessorId, GpuMemoryUsage> usage;
+
+    void Add(ProcessorId owner, uint64_t bytes, bool texture);
+    void Remove(ProcessorId owner, uint64_t bytes, bool texture);
+  };
+
+  void EnsureBudgetFor(uint64_t bytes);
+
+  static constexpr uint64_t default_budget = uint64_t(2) << 30;
+
+  // shared with the deleters of the allocated resources, which can outlive this object
+  std::shared_ptr<Accounting> accounting;
+  uint64_t budget = default_budget;
+  uint64_t tick = 0;
+};
+
+uint64_t GetTextureSize(wgpu::TextureDescriptor const& desc);
@@ -0,0 +1,41 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "group_memo.h"
+#include "app.h"
+
+size_t GroupMemo::KeyHash::operator()(Key const& key) const {
+  auto hash = std::hash<std::string>{}(key.template_name);
+  for (auto version : key.input_versions) {
+    hash ^= std::hash<uint64_t>{}(version) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+GroupMemo& GroupMemo::Get() {
+  static GroupMemo memo{};
+  return memo;
+}
+
+GroupMemo::GroupMemo() {
+  App::Get().onNewFrame.push_back([this] { BeginFrame(); });
+}
+
+void GroupMemo::BeginFrame() {
+  auto lock = std::lock_guard(mutex);
+  evaluated.clear();
+}
+
+ProcessorId GroupMemo::Find(Key const& key) {
+  auto lock = std::lock_guard(mutex);
+  auto it = evaluated.find(key);
+  return it != evaluated.end() ? it->second : UNLINKED;
+}
+
+void GroupMemo::Insert(Key key, ProcessorId evaluated_by) {
+  auto lock = std::lock_guard(mutex);
+  evaluated.insert_or_assign(std::move(key), evaluated_by);
+}
@@ -0,0 +1,42 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <mutex>
+#include <unordered_map>
+
+// Remembers, for the current frame, which instance of a group template evaluated which boundary inputs, so that
+// other instances of the same template with the same inputs take its outputs instead of evaluating their graphs.
+// Forgotten at the start of each frame, as the graphs of the groups may depend on more than their inputs.
+class GroupMemo final {
+public:
+  struct Key {
+    std::string template_name;
+    std::vector<uint64_t> input_versions;
+
+    bool operator==(Key const&) const = default;
+  };
+
+  static GroupMemo& Get();
+
+  // UNLINKED if no instance evaluated these inputs in this frame
+  ProcessorId Find(Key const& key);
+  void Insert(Key key, ProcessorId evaluated_by);
+
+private:
+  GroupMemo();
+
+  struct KeyHash {
+    size_t operator()(Key const& key) const;
+  };
+
+  void BeginFrame();
+
+  std::mutex mutex;
+  std::unordered_map<Key, ProcessorId, KeyHash> evaluated;
+};
@@ -5,11 +5,21 @@
  */
 
 #include "app.h"
+#include "gpu_memory.h"
 #include "imgui.h"
+#include "profiler.h"
+#include <string_view>
 
 int main(int argc, char* argv[]) {
+  // Only checks that an offscreen device can be created, e.g. on a CPU-only server
+  if (argc > 1 && std::string_view(argv[1]) == "--headless") {
+    return App::Get().CreateHeadlessDevice() ? 0 : 1;
+  }
+
   bool show_demo_window = true;
   bool show_another_window = true;
+  bool show_profiler = false;
+  bool show_gpu_memory = false;
   App::Get().CreateWindowAndStartMainLoop([&] {
     // 1. Show the big demo window (Most of the sample code is in ImGui::ShowDemoWindow()! You can browse its code to
     // learn more about Dear ImGui!).
@@ -26,6 +36,8 @@ int main(int argc, char* argv[]) {
       ImGui::Text("This is some useful text.");          // Display some text (you can use a format strings too)
       ImGui::Checkbox("Demo Window", &show_demo_window); // Edit bools storing our window open/close state
       ImGui::Checkbox("Another Window", &show_another_window);
+      ImGui::Checkbox("Profiler", &show_profiler);
+      ImGui::Checkbox("GPU Memory", &show_gpu_memory);
 
       ImGui::SliderFloat("float", &f, 0.0f, 1.0f);                      // Edit 1 float using a slider from 0.0f to 1.0f
       ImGui::ColorEdit3("clear color", (float*)&App::Get().clearColor); // Edit 3 floats representing a color
@@ -49,5 +61,11 @@ int main(int argc, char* argv[]) {
         show_another_window = false;
       ImGui::End();
     }
+
+    if (show_profiler)
+      Profiler::Get().DrawOverlay(&show_profiler);
+
+    if (show_gpu_memory)
+      GpuMemory::Get().DrawOverlay(&show_gpu_memory);
   });
 }
@@ -0,0 +1,216 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// An immutable map from integer keys to values: a trie of 32 way nodes that store only their present children.
+// Set and Erase return a new map that copies just the nodes on the path to the key and shares all the others, so
+// keeping many versions of a large map costs memory proportional to the changes between them.
+template<class Value>
+class PersistentMap final {
+public:
+  Value const* Find(uint64_t key) const {
+    if (!root || (shift + bits < 64 && key >> (shift + bits) != 0)) {
+      return nullptr;
+    }
+    auto node = root.get();
+    for (auto s = shift;; s -= bits) {
+      auto const bit = 1u << ((key >> s) & mask);
+      if (!(node->bitmap & bit)) {
+        return nullptr;
+      }
+      auto const index = GetIndex(node->bitmap, bit);
+      if (s == 0) {
+        return &node->values[index];
+      }
+      node = node->children[index].get();
+    }
+  }
+
+  PersistentMap Set(uint64_t key, Value value) const {
+    auto result = *this;
+    if (!result.root) {
+      result.shift = 0;
+    }
+    while (result.shift + bits < 64 && key >> (result.shift + bits) != 0) {
+      if (result.root) {
+        auto wrapper = std::make_shared<Node>();
+        wrapper->bitmap = 1;
+        wrapper->children.push_back(std::move(result.root));
+        result.root = std::move(wrapper);
+      }
+      result.shift += bits;
+    }
+    bool inserted = false;
+    result.root = SetIn(result.root.get(), result.shift, key, std::move(value), inserted);
+    if (inserted) {
+      ++result.size;
+    }
+    return result;
+  }
+
+  PersistentMap Erase(uint64_t key) const {
+    if (!Find(key)) {
+      return *this;
+    }
+    auto result = *this;
+    result.root = EraseIn(root.get(), shift, key);
+    --result.size;
+    return result;
+  }
+
+  size_t GetSize() const { return size; }
+  bool IsEmpty() const { return size == 0; }
+
+  // callback(key, value), in order of keys
+  template<class Callback>
+  void ForEach(Callback const& callback) const {
+    ForEachIn(root.get(), shift, 0, callback);
+  }
+
+  // callback(key, value in this or nullptr, value in other or nullptr) for the keys whose values are not equal.
+  // Subtrees shared by the two maps are skipped, so diffing versions of the same map costs as much as their changes.
+  template<class Callback>
+  void Diff(PersistentMap const& other, Callback const& callback) const {
+    auto const top = std::max(shift, other.shift);
+    auto const a = Lift(root, shift, top);
+    auto const b = Lift(other.root, other.shift, top);
+    DiffIn(a.get(), b.get(), top, 0, callback);
+  }
+
+private:
+  static constexpr uint32_t bits = 5;
+  static constexpr uint64_t mask = (1 << bits) - 1;
+
+  struct Node {
+    uint32_t bitmap = 0;
+    std::vector<std::shared_ptr<Node const>> children; // when above the leaves
+    std::vector<Value> values;                         // in the leaves
+  };
+
+  static uint32_t GetIndex(uint32_t bitmap, uint32_t bit) { return uint32_t(std::popcount(bitmap & (bit - 1))); }
+
+  static std::shared_ptr<Node const> SetIn(Node const* node, uint32_t s, uint64_t key, Value value, bool& inserted) {
+    auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+    auto const bit = 1u << ((key >> s) & mask);
+    auto const index = GetIndex(copy->bitmap, bit);
+    auto const present = (copy->bitmap & bit) != 0;
+    if (s == 0) {
+      if (present) {
+        copy->values[index] = std::move(value);
+      }
+      else {
+        copy->values.insert(copy->values.begin() + index, std::move(value));
+        inserted = true;
+      }
+    }
+    else {
+      auto child = SetIn(present ? copy->children[index].get() : nullptr, s - bits, key, std::move(value), inserted);
+      if (present) {
+        copy->children[index] = std::move(child);
+      }
+      else {
+        copy->children.insert(copy->children.begin() + index, std::move(child));
+      }
+    }
+    copy->bitmap |= bit;
+    return copy;
+  }
+
+  static std::shared_ptr<Node const> EraseIn(Node const* node, uint32_t s, uint64_t key) {
+    auto copy = std::make_shared<Node>(*node);
+    auto const bit = 1u << ((key >> s) & mask);
+    auto const index = GetIndex(copy->bitmap, bit);
+    if (s == 0) {
+      copy->values.erase(copy->values.begin() + index);
+      copy->bitmap &= ~bit;
+    }
+    else if (auto child = EraseIn(copy->children[index].get(), s - bits, key)) {
+      copy->children[index] = std::move(child);
+    }
+    else {
+      copy->children.erase(copy->children.begin() + index);
+      copy->bitmap &= ~bit;
+    }
+    if (copy->bitmap == 0) {
+      return nullptr;
+    }
+    return copy;
+  }
+
+  static std::shared_ptr<Node const> Lift(std::shared_ptr<Node const> node, uint32_t from, uint32_t to) {
+    for (; node && from < to; from += bits) {
+      auto wrapper = std::make_shared<Node>();
+      wrapper->bitmap = 1;
+      wrapper->children.push_back(std::move(node));
+      node = std::move(wrapper);
+    }
+    return node;
+  }
+
+  template<class Callback>
+  static void ForEachIn(Node const* node, uint32_t s, uint64_t prefix, Callback const& callback) {
+    if (!node) {
+      return;
+    }
+    uint32_t index = 0;
+    for (uint64_t slot = 0; slot <= mask; ++slot) {
+      if (!(node->bitmap & (1u << slot))) {
+        continue;
+      }
+      auto const key = prefix | (slot << s);
+      if (s == 0) {
+        callback(key, node->values[index]);
+      }
+      else {
+        ForEachIn(node->children[index].get(), s - bits, key, callback);
+      }
+      ++index;
+    }
+  }
+
+  template<class Callback>
+  static void DiffIn(Node const* a, Node const* b, uint32_t s, uint64_t prefix, Callback const& callback) {
+    if (a == b) {
+      return;
+    }
+    auto const a_bitmap = a ? a->bitmap : 0;
+    auto const b_bitmap = b ? b->bitmap : 0;
+    for (uint64_t slot = 0; slot <= mask; ++slot) {
+      auto const bit = 1u << slot;
+      auto const in_a = (a_bitmap & bit) != 0;
+      auto const in_b = (b_bitmap & bit) != 0;
+      if (!in_a && !in_b) {
+        continue;
+      }
+      auto const key = prefix | (slot << s);
+      if (s == 0) {
+        auto const value_a = in_a ? &a->values[GetIndex(a_bitmap, bit)] : nullptr;
+        auto const value_b = in_b ? &b->values[GetIndex(b_bitmap, bit)] : nullptr;
+        if (!value_a || !value_b || !(*value_a == *value_b)) {
+          callback(key, value_a, value_b);
+        }
+      }
+      else {
+        DiffIn(in_a ? a->children[GetIndex(a_bitmap, bit)].get() : nullptr,
+               in_b ? b->children[GetIndex(b_bitmap, bit)].get() : nullptr,
+               s - bits,
+               key,
+               callback);
+      }
+    }
+  }
+
+  std::shared_ptr<Node const> root;
+  uint32_t shift = 0; // of the root, the leaves are at 0
+  size_t size = 0;
+};
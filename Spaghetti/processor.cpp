@@ -5,6 +5,11 @@
  */
 
 #include "processor.h"
+#include "frame_range.h"
+#include "gpu_memory.h"
+#include "group_memo.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include <algorithm>
 #include <unordered_set>
 
@@ -15,7 +20,9 @@ Processor* Processor::Get(ProcessorId id) {
   return nullptr;
 }
 
-Processor::~Processor() {}
+Processor::~Processor() {
+  MarkEdited();
+}
 
 bool Processor::CanProcess() const {
   for (auto const& in : inputs) {
@@ -31,26 +38,44 @@ bool Processor::CanProcess() const {
   return true;
 }
 
-void Processor::AddInput(Input in) {}
+void Processor::AddInput(Input in) {
+  MarkEdited();
+}
 
-void Processor::AddOutput(std::unique_ptr<Data> out) {}
+void Processor::AddOutput(std::unique_ptr<Data> out) {
+  MarkEdited();
+}
 
-void Processor::RemoveInput(uint32_t index) {}
+void Processor::RemoveInput(uint32_t index) {
+  MarkEdited();
+}
 
-void Processor::RemoveOutput(uint32_t index) {}
+void Processor::RemoveOutput(uint32_t index) {
+  MarkEdited();
+}
 
-void Processor::MoveInput(uint32_t prev_index, uint32_t new_index) {}
+void Processor::MoveInput(uint32_t prev_index, uint32_t new_index) {
+  MarkEdited();
+}
 
-void Processor::MoveOuput(uint32_t prev_index, uint32_t new_index) {}
+void Processor::MoveOuput(uint32_t prev_index, uint32_t new_index) {
+  MarkEdited();
+}
 
-void Processor::SetInput(uint32_t index, Input in) {}
+void Processor::SetInput(uint32_t index, Input in) {
+  MarkEdited();
+}
 
-void Processor::SetOutput(uint32_t index, std::unique_ptr<Data> out) {}
+void Processor::SetOutput(uint32_t index, std::unique_ptr<Data> out) {
+  MarkEdited();
+}
 
-void Processor::AddInputLink(uint32_t input_index, DataAddress linkedOutput) {
+void Processor::AddInputLink(uint32_t input_index, DataAddress linkedOutput, LinkType link_type) {
   if (input_index < inputs.size()) {
     inputs[input_index].linkedOutput = linkedOutput;
+    inputs[input_index].link_type = link_type;
   }
+  MarkEdited();
   SetNeedsUpdate();
 }
 
@@ -64,6 +89,96 @@ void Processor::AddOutputLink(uint32_t output_index, DataAddress linkedInput) {
     links.push_back(linkedInput);
     outputLinks[output_index] = std::move(links);
   }
+  MarkEdited();
+}
+
+void Processor::MarkEdited() {
+  edited.insert(id);
+}
+
+void Processor::RemoveInputLink(uint32_t input_index) {
+  if (input_index < inputs.size()) {
+    inputs[input_index].linkedOutput = {};
+    inputs[input_index].link_type = LinkType::immediate;
+    inputs[input_index].convertedData.reset();
+  }
+  MarkEdited();
+  SetNeedsUpdate();
+}
+
+void Processor::RemoveOutputLink(uint32_t output_index, DataAddress linkedInput) {
+  auto it = outputLinks.find(output_index);
+  if (it != outputLinks.end()) {
+    std::erase(it->second, linkedInput);
+    if (it->second.empty()) {
+      outputLinks.erase(it);
+    }
+  }
+  MarkEdited();
+}
+
+void Processor::AddPreviousFrameLink(uint32_t output_index) {
+  ++previous_outputs[output_index].num_links;
+}
+
+void Processor::RemovePreviousFrameLink(uint32_t output_index) {
+  auto it = previous_outputs.find(output_index);
+  if (it != previous_outputs.end() && --it->second.num_links == 0) {
+    previous_outputs.erase(it);
+  }
+}
+
+Data* Processor::GetPreviousFrameOutput(uint32_t output_index) const {
+  auto it = previous_outputs.find(output_index);
+  if (it != previous_outputs.end() && it->second.kept_this_frame) {
+    return it->second.data.get();
+  }
+  // not run yet in this frame
+  return output_index < outputs.size() ? outputs[output_index].get() : nullptr;
+}
+
+void Processor::BeginFrame() {
+  for (auto& previous : previous_outputs) {
+    previous.second.kept_this_frame = false;
+  }
+}
+
+void Processor::KeepPreviousOutputs() {
+  for (auto& [index, previous] : previous_outputs) {
+    if (previous.kept_this_frame || index >= outputs.size() || !outputs[index]) {
+      continue;
+    }
+    auto& out = *outputs[index];
+    auto kept = out.Clone();
+    // the textures and buffers of the output are now also those of the kept data: the processor must render into
+    // others, the ones of the frame before if they still fit
+    auto older = previous.data.get();
+    if (older && older->signature == out.signature && out.signature.type == Type::image) {
+      static_cast<Image&>(out).data = static_cast<Image*>(older)->data;
+      static_cast<Image&>(out).damage = DamageRegion::Full();
+    }
+    else if (older && older->signature == out.signature && out.signature.type == Type::buffer) {
+      static_cast<Buffer&>(out).data = static_cast<Buffer*>(older)->data;
+    }
+    else {
+      ReleaseGpuResources(out);
+    }
+    previous.data = std::move(kept);
+    previous.kept_this_frame = true;
+  }
+}
+
+void Processor::Run() {
+  processing = true;
+  auto const begin = Profiler::Now();
+  KeepPreviousOutputs();
+  Process();
+  Profiler::Get().RecordCpuTime(id, begin, Profiler::Now());
+  processing = false;
+  evicted = false;
+  TouchOutputs();
+  ClearDamage();
+  ClearReadbacks();
 }
 
 bool Processor::NeedsUpdate() {
@@ -75,12 +190,32 @@ bool Processor::NeedsUpdate() {
 }
 
 void Processor::SetNeedsUpdate() {
-  if (needs_update == false) {
-    needs_update = true;
-    for (auto& out_clients : outputLinks) {
-      for (auto client : out_clients.second) {
-        Processor::Get(client.processor)->SetNeedsUpdate();
-      }
+  SetNeedsUpdate(DamageRegion::Full());
+}
+
+void Processor::SetNeedsUpdate(DamageRegion const& input_damage) {
+  auto const output_damage = ExpandDamage(input_damage);
+  bool damage_grew = false;
+  for (auto& out : outputs) {
+    if (out && out->signature.type == Type::image) {
+      damage_grew |= static_cast<Image*>(out.get())->damage.Merge(output_damage);
+    }
+  }
+  if (needs_update && !damage_grew) {
+    return;
+  }
+  needs_update = true;
+  for (auto& out_clients : outputLinks) {
+    for (auto client : out_clients.second) {
+      Processor::Get(client.processor)->SetNeedsUpdate(output_damage);
+    }
+  }
+}
+
+void Processor::ClearDamage() {
+  for (auto& out : outputs) {
+    if (out && out->signature.type == Type::image) {
+      static_cast<Image*>(out.get())->damage.Clear();
     }
   }
 }
@@ -88,7 +223,7 @@ void Processor::SetNeedsUpdate() {
 bool Processor::HasLinkedInputs() {
   bool anyInput = false;
   for (auto& in : inputs) {
-    if (in.linkedOutput.processor != UNLINKED) {
+    if (in.IsImmediatelyLinked()) {
       anyInput = true;
       break;
     }
@@ -96,15 +231,198 @@ bool Processor::HasLinkedInputs() {
   return anyInput;
 }
 
+bool Processor::PrepareReadbacks() {
+  if (!ReadsGpuDataOnCpu() || !needs_update) {
+    return true;
+  }
+  readbacks.resize(inputs.size());
+  bool ready = true;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    auto data = inputs[i].GetInputData();
+    auto& futures = readbacks[i];
+    if (!data || (data->signature.type != Type::image && data->signature.type != Type::buffer)) {
+      futures.clear();
+      continue;
+    }
+    if (futures.empty()) {
+      futures = ReadBackData(*data);
+    }
+    for (auto const& future : futures) {
+      ready = ready && future->ready;
+    }
+  }
+  return ready;
+}
+
+void Processor::ClearReadbacks() {
+  readbacks.clear();
+}
+
+std::vector<ReadbackFuture> ReadBackData(Data const& data) {
+  auto futures = std::vector<ReadbackFuture>{};
+  if (data.signature.type == Type::image) {
+    for (auto const& texture : static_cast<Image const&>(data).data) {
+      futures.push_back(ReadbackRing::Get().Read(texture));
+    }
+  }
+  if (data.signature.type == Type::buffer) {
+    for (auto const& buffer : static_cast<Buffer const&>(data).data) {
+      futures.push_back(ReadbackRing::Get().Read(buffer));
+    }
+  }
+  return futures;
+}
+
+std::vector<std::unique_ptr<Data>> const& Processor::GetOutputs() const {
+  if (auto state = EvaluationState::GetCurrent()) {
+    if (auto state_outputs = state->FindOutputs(id)) {
+      return *state_outputs;
+    }
+  }
+  return outputs;
+}
+
+std::vector<std::unique_ptr<Data>>& Processor::GetMutableOutputs() {
+  if (auto state = EvaluationState::GetCurrent()) {
+    if (auto state_outputs = state->FindOutputs(id)) {
+      return *state_outputs;
+    }
+  }
+  return outputs;
+}
+
+std::vector<ReadbackFuture> const& Processor::GetReadbacks(uint32_t input_index) const {
+  if (auto state = EvaluationState::GetCurrent()) {
+    if (auto state_readbacks = state->FindReadbacks(id, input_index)) {
+      return *state_readbacks;
+    }
+  }
+  return readbacks[input_index];
+}
+
+void Processor::TouchOutputs() {
+  for (auto& out : outputs) {
+    if (out) {
+      out->Touch();
+    }
+  }
+}
+
+bool Processor::AnyClientNeedsUpdate() const {
+  for (auto& out_clients : outputLinks) {
+    for (auto client : out_clients.second) {
+      auto p = Processor::Get(client.processor);
+      if (p && (p->needs_update || p->processing)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool Processor::CanEvict() const {
+  return !evicted && !needs_update && !processing && !AnyClientNeedsUpdate();
+}
+
+void Processor::EvictGpuOutputs() {
+  for (auto& out : outputs) {
+    if (!out) {
+      continue;
+    }
+    if (out->signature.type == Type::image) {
+      for (auto& texture : static_cast<Image*>(out.get())->data) {
+        texture.reset();
+      }
+    }
+    if (out->signature.type == Type::buffer) {
+      for (auto& buffer : static_cast<Buffer*>(out.get())->data) {
+        buffer.reset();
+      }
+    }
+  }
+  evicted = true;
+}
+
 Processor::Processor()
-  : id{ count } {}
+  : id{ count } {
+  MarkEdited();
+}
 
 Processor::Processor(ProcessorId id)
-  : id{ id } {}
+  : id{ id } {
+  MarkEdited();
+}
 
 PixelProcessor::PixelProcessor() {}
 
-void PixelProcessor::Process() {}
+void PixelProcessor::Process() {
+  // todo render the fragment shader, loading the previous content unless IsFullyDamaged, and drawing with DrawDamaged
+}
+
+DamageRegion PixelProcessor::ExpandDamage(DamageRegion const& input_damage) const {
+  switch (damage_expansion) {
+    case DamageExpansion::pointwise:
+      return input_damage;
+    case DamageExpansion::radius:
+      return input_damage.Expanded(damage_radius);
+    case DamageExpansion::full:
+      break;
+  }
+  return DamageRegion::Full();
+}
+
+void PixelProcessor::SetDamageExpansion(DamageExpansion expansion, uint32_t radius) {
+  damage_expansion = expansion;
+  damage_radius = radius;
+  SetNeedsUpdate();
+}
+
+static Image const* GetImageOutput(std::vector<std::unique_ptr<Data>> const& outputs, uint32_t output_index) {
+  if (output_index >= outputs.size()) {
+    return nullptr;
+  }
+  auto out = outputs[output_index].get();
+  if (!out || out->signature.type != Type::image) {
+    return nullptr;
+  }
+  auto image = static_cast<Image const*>(out);
+  if (image->data.empty() || !image->data[0]) {
+    return nullptr;
+  }
+  return image;
+}
+
+bool PixelProcessor::IsFullyDamaged(uint32_t output_index) const {
+  auto image = GetImageOutput(GetOutputs(), output_index);
+  if (!image) {
+    return true;
+  }
+  if (image->damage.full) {
+    return true;
+  }
+  auto const& texture = *image->data[0];
+  auto const whole = Rect{ 0, 0, texture->getWidth(), texture->getHeight() };
+  for (auto const& rect : image->damage.rects) {
+    if (rect.Clipped(whole.width, whole.height) == whole) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PixelProcessor::DrawDamaged(wgpu::RenderPassEncoder pass,
+                                 uint32_t output_index,
+                                 std::function<void(wgpu::RenderPassEncoder)> const& draw) const {
+  auto image = GetImageOutput(GetOutputs(), output_index);
+  if (!image) {
+    return;
+  }
+  auto const& texture = *image->data[0];
+  for (auto const& rect : image->damage.Clipped(texture->getWidth(), texture->getHeight())) {
+    pass.setScissorRect(rect.x, rect.y, rect.width, rect.height);
+    draw(pass);
+  }
+}
 
 ComputeProcessor::ComputeProcessor() {}
 
@@ -126,7 +444,7 @@ void BuiltinProcessor::SetProcessingCall(BuiltinProcessingCall call) {
 
 void BuiltinProcessor::Process() {
   if (process_call) {
-    process_call(inputs, outputs);
+    process_call(inputs, GetMutableOutputs());
   }
 }
 
@@ -140,8 +458,7 @@ void Graph::Execute() {
   auto CheckReady = [&](Processor* p) {
     bool is_ready = true;
     for (auto& in : p->GetInputs()) {
-      auto in_processor = in.linkedOutput.processor;
-      if (!(in_processor == UNLINKED || done.find(Processor::Get(in_processor)) != done.end())) {
+      if (in.IsImmediatelyLinked() && done.find(Processor::Get(in.linkedOutput.processor)) == done.end()) {
         is_ready = false;
         break;
       }
@@ -155,8 +472,15 @@ void Graph::Execute() {
   };
 
   auto Process = [&](Processor* p) {
-    if (p->NeedsUpdate()) {
-      p->Process();
+    if (!p->PrepareReadbacks()) {
+      // its readbacks are still in flight: leave it and its clients for the next frame
+      return;
+    }
+    GpuMemory::Get().MarkUsed(p->id);
+    // an evicted processor is clean, but must regenerate its outputs if one of its clients is going to read them
+    bool const regenerate = p->IsEvicted() && p->AnyClientNeedsUpdate();
+    if (p->NeedsUpdate() || regenerate) {
+      p->Run();
     }
     done.insert(p);
     auto const& outputs = p->GetOutputLinks();
@@ -168,12 +492,17 @@ void Graph::Execute() {
     }
   };
 
+  BeginFrame();
   for (auto pid : no_input_processors) {
     Process(Processor::Get(pid));
   }
   while (!backlog.empty() || !ready.empty()) {
     processing = std::move(ready);
     ready.clear();
+    if (processing.empty()) {
+      // the backlog is waiting on processors that could not run this frame
+      break;
+    }
     prev_backlog = std::move(backlog);
     backlog.clear();
     for (auto* p : processing) {
@@ -185,12 +514,48 @@ void Graph::Execute() {
   }
 }
 
-LinkId Graph::CreateLink(DataAddress output, DataAddress input) {
-  Processor::Get(input.processor)->AddInputLink(input.data_index, output);
-  Processor::Get(output.processor)->AddOutputLink(output.data_index, input);
-  no_input_processors.erase(input.processor);
+void Graph::BeginFrame() {
+  for (auto& [id, link] : links) {
+    if (link.link_type != LinkType::previous_frame) {
+      continue;
+    }
+    auto producer = Processor::Get(link.output.processor);
+    producer->BeginFrame();
+    auto previous = producer->GetPreviousFrameOutput(link.output.data_index);
+    auto const version = previous ? previous->version : 0;
+    if (version != link.read_version) {
+      link.read_version = version;
+      Processor::Get(link.input.processor)->SetNeedsUpdate();
+    }
+  }
+}
+
+LinkId Graph::CreateLink(DataAddress output, DataAddress input, LinkType link_type) {
+  auto producer = Processor::Get(output.processor);
+  auto consumer = Processor::Get(input.processor);
+  if (link_type == LinkType::immediate) {
+    if (!InsertInOrder(output.processor, input.processor)) {
+      return NO_LINK;
+    }
+    consumer->AddInputLink(input.data_index, output);
+    producer->AddOutputLink(output.data_index, input);
+    no_input_processors.erase(input.processor);
+  }
+  else {
+    // no output link, so that updates do not propagate through it: the input is read at the start of the next frame
+    GetOrderIndex(output.processor);
+    GetOrderIndex(input.processor);
+    consumer->AddInputLink(input.data_index, output, link_type);
+    producer->AddPreviousFrameLink(output.data_index);
+    if (!consumer->HasLinkedInputs()) {
+      no_input_processors.insert(input.processor);
+    }
+  }
+  if (!producer->HasLinkedInputs()) {
+    no_input_processors.insert(output.processor);
+  }
   linkCount++;
-  links[linkCount] = { output, input };
+  links[linkCount] = { output, input, link_type };
   return linkCount;
 }
 
@@ -199,7 +564,7 @@ void Graph::RemoveLink(LinkId link_id) {
   if (it != links.end()) {
     auto in = it->second.input;
     auto in_processor = Processor::Get(in.processor);
-    in_processor->RemoveInput(in.data_index);
+    in_processor->RemoveInputLink(in.data_index);
     if (in_processor->HasLinkedInputs()) {
       no_input_processors.erase(in.processor);
     }
@@ -207,19 +572,283 @@ void Graph::RemoveLink(LinkId link_id) {
       no_input_processors.insert(in.processor);
     }
     auto out = it->second.output;
-    Processor::Get(out.processor)->RemoveOutput(out.data_index);
+    if (it->second.link_type == LinkType::immediate) {
+      Processor::Get(out.processor)->RemoveOutputLink(out.data_index, in);
+    }
+    else {
+      Processor::Get(out.processor)->RemovePreviousFrameLink(out.data_index);
+    }
+    // removing a link never invalidates the order
+    links.erase(it);
   }
 }
 
+uint32_t Graph::GetOrderIndex(ProcessorId id) {
+  auto it = order_index.find(id);
+  if (it != order_index.end()) {
+    return it->second;
+  }
+  order.push_back(id);
+  order_index[id] = uint32_t(order.size() - 1);
+  return uint32_t(order.size() - 1);
+}
+
+void Graph::RebuildOrder() {
+  std::unordered_map<ProcessorId, size_t> num_dependencies;
+  std::vector<ProcessorId> ready;
+  for (auto id : order) {
+    auto& n = num_dependencies[id];
+    for (auto const& in : Processor::Get(id)->GetInputs()) {
+      if (in.IsImmediatelyLinked() && order_index.find(in.linkedOutput.processor) != order_index.end()) {
+        ++n;
+      }
+    }
+    if (n == 0) {
+      ready.push_back(id);
+    }
+  }
+  std::vector<ProcessorId> sorted;
+  sorted.reserve(order.size());
+  while (!ready.empty()) {
+    auto id = ready.back();
+    ready.pop_back();
+    sorted.push_back(id);
+    for (auto const& out_clients : Processor::Get(id)->GetOutputLinks()) {
+      for (auto client : out_clients.second) {
+        auto it = num_dependencies.find(client.processor);
+        if (it != num_dependencies.end() && --it->second == 0) {
+          ready.push_back(client.processor);
+        }
+      }
+    }
+  }
+  if (sorted.size() != order.size()) {
+    // cyclic, which link edits never allow
+    return;
+  }
+  order = std::move(sorted);
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    order_index[order[i]] = i;
+  }
+}
+
+// Pearce-Kelly dynamic topological sort: when the new link goes backwards in the order, only the processors between
+// its two ends are visited and shuffled, so editing links stays cheap however large the graph is.
+bool Graph::InsertInOrder(ProcessorId from, ProcessorId to) {
+  if (from == to) {
+    return false;
+  }
+  auto const from_index = GetOrderIndex(from);
+  auto const to_index = GetOrderIndex(to);
+  if (from_index < to_index) {
+    return true;
+  }
+
+  // what follows `to`, up to `from`: reaching `from` means a cycle
+  std::vector<ProcessorId> forward;
+  std::unordered_set<ProcessorId> visited{ to };
+  std::vector<ProcessorId> to_visit{ to };
+  while (!to_visit.empty()) {
+    auto id = to_visit.back();
+    to_visit.pop_back();
+    forward.push_back(id);
+    for (auto const& out_clients : Processor::Get(id)->GetOutputLinks()) {
+      for (auto client : out_clients.second) {
+        if (client.processor == from) {
+          return false;
+        }
+        auto it = order_index.find(client.processor);
+        if (it != order_index.end() && it->second < from_index && visited.insert(client.processor).second) {
+          to_visit.push_back(client.processor);
+        }
+      }
+    }
+  }
+
+  // what precedes `from`, down to `to`
+  std::vector<ProcessorId> backward;
+  visited = { from };
+  to_visit = { from };
+  while (!to_visit.empty()) {
+    auto id = to_visit.back();
+    to_visit.pop_back();
+    backward.push_back(id);
+    for (auto const& in : Processor::Get(id)->GetInputs()) {
+      if (!in.IsImmediatelyLinked()) {
+        continue;
+      }
+      auto it = order_index.find(in.linkedOutput.processor);
+      if (it != order_index.end() && it->second > to_index && visited.insert(in.linkedOutput.processor).second) {
+        to_visit.push_back(in.linkedOutput.processor);
+      }
+    }
+  }
+
+  // the same slots, with all of backward moved before all of forward
+  auto by_index = [&](ProcessorId a, ProcessorId b) { return order_index[a] < order_index[b]; };
+  std::sort(forward.begin(), forward.end(), by_index);
+  std::sort(backward.begin(), backward.end(), by_index);
+  std::vector<uint32_t> slots;
+  slots.reserve(forward.size() + backward.size());
+  for (auto id : backward) {
+    slots.push_back(order_index[id]);
+  }
+  for (auto id : forward) {
+    slots.push_back(order_index[id]);
+  }
+  std::sort(slots.begin(), slots.end());
+  size_t slot = 0;
+  for (auto const* ids : { &backward, &forward }) {
+    for (auto id : *ids) {
+      order[slots[slot]] = id;
+      order_index[id] = slots[slot];
+      ++slot;
+    }
+  }
+  return true;
+}
+
+void Graph::Restore(GraphSnapshot const& snapshot) {
+  // diffing against the live state, edits not captured yet included
+  GraphSnapshot::Capture();
+  auto& latest = GraphSnapshot::GetLatest();
+  std::set<ProcessorId> restored;
+  snapshot.processors.Diff(latest.processors, [&](ProcessorId id, auto const* to, auto const*) {
+    auto p = Processor::Get(id);
+    if (p && to) {
+      GraphSnapshot::Restore(*p, **to);
+      latest.processors = latest.processors.Set(id, *to);
+      restored.insert(id);
+    }
+  });
+
+  std::set<ProcessorId> in_graph;
+  std::erase_if(links, [&](auto const& link) {
+    auto const input_processor = link.second.input.processor;
+    if (restored.find(input_processor) == restored.end()) {
+      return false;
+    }
+    in_graph.insert(input_processor);
+    auto producer = Processor::Get(link.second.output.processor);
+    if (producer && link.second.link_type == LinkType::previous_frame) {
+      producer->RemovePreviousFrameLink(link.second.output.data_index);
+    }
+    return true;
+  });
+  for (auto id : restored) {
+    auto p = Processor::Get(id);
+    auto const& inputs = p->GetInputs();
+    for (uint32_t i = 0; i < inputs.size(); ++i) {
+      if (inputs[i].linkedOutput.processor != UNLINKED) {
+        links[++linkCount] = { inputs[i].linkedOutput, { id, i }, inputs[i].link_type };
+        if (inputs[i].link_type == LinkType::previous_frame) {
+          Processor::Get(inputs[i].linkedOutput.processor)->AddPreviousFrameLink(inputs[i].linkedOutput.data_index);
+        }
+        in_graph.insert(id);
+        GetOrderIndex(inputs[i].linkedOutput.processor);
+        GetOrderIndex(id);
+      }
+    }
+    if (p->HasLinkedInputs()) {
+      no_input_processors.erase(id);
+    }
+    else if (in_graph.find(id) != in_graph.end() || no_input_processors.find(id) != no_input_processors.end()) {
+      no_input_processors.insert(id);
+    }
+  }
+  // many links may have changed at once
+  RebuildOrder();
+}
+
 GroupProcessor::GroupProcessor() {}
 
+void GroupProcessor::Process() {
+  if (template_name.empty()) {
+    graph.Execute();
+    return;
+  }
+  auto key = GroupMemo::Key{ template_name };
+  for (auto const& in : inputs) {
+    auto data = in.GetInputData();
+    key.input_versions.push_back(data ? data->version : 0);
+  }
+  auto const evaluated_by = GroupMemo::Get().Find(key);
+  if (evaluated_by != UNLINKED && evaluated_by != id && TakeMemoizedOutputs(evaluated_by)) {
+    return;
+  }
+  ReleaseSharedOutputs();
+  graph.Execute();
+  GroupMemo::Get().Insert(std::move(key), id);
+}
+
+bool GroupProcessor::TakeMemoizedOutputs(ProcessorId evaluated_by) {
+  auto other = Processor::Get(evaluated_by);
+  if (!other || other->GetOutputs().size() != GetOutputs().size()) {
+    return false;
+  }
+  auto const& other_outputs = other->GetOutputs();
+  auto& outputs = GetMutableOutputs();
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (!outputs[i] || !other_outputs[i] || !(outputs[i]->signature == other_outputs[i]->signature)) {
+      return false;
+    }
+  }
+  // textures and buffers are shared, not copied
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    outputs[i] = other_outputs[i]->Clone();
+  }
+  return true;
+}
+
+void GroupProcessor::ReleaseSharedOutputs() {
+  // textures and buffers taken from, or given to, other instances must not be rendered into
+  for (auto& out : GetMutableOutputs()) {
+    if (!out) {
+      continue;
+    }
+    bool shared = false;
+    if (out->signature.type == Type::image) {
+      for (auto const& texture : static_cast<Image&>(*out).data) {
+        shared = shared || texture.use_count() > 1;
+      }
+    }
+    if (out->signature.type == Type::buffer) {
+      for (auto const& buffer : static_cast<Buffer&>(*out).data) {
+        shared = shared || buffer.use_count() > 1;
+      }
+    }
+    if (shared) {
+      ReleaseGpuResources(*out);
+    }
+  }
+}
+
+
+Data* Input::GetLinkedData() const {
+  auto p = Processor::Get(linkedOutput.processor);
+  if (!p) {
+    return nullptr;
+  }
+  if (link_type == LinkType::previous_frame) {
+    return p->GetPreviousFrameOutput(linkedOutput.data_index);
+  }
+  return p->GetOutputs()[linkedOutput.data_index].get();
+}
+
 Data* Input::GetInputData() const {
-  if (auto p = Processor::Get(linkedOutput.processor)) {
-    auto linkedData = p->GetOutputs()[linkedOutput.data_index].get();
+  if (auto linkedData = GetLinkedData()) {
     if (linkedData->signature == signature) {
       return linkedData;
     }
-    else if (convertedData) {
+    auto state = EvaluationState::GetCurrent();
+    if (auto state_converted = state ? state->FindConverted(this) : nullptr) {
+      return state_converted;
+    }
+    if (CanView(linkedData->signature, signature) && (!convertedData || converted_version != linkedData->version)) {
+      convertedData = linkedData->ConvertTo(signature);
+      converted_version = linkedData->version;
+    }
+    if (convertedData) {
       return convertedData.get();
     }
   }
@@ -251,12 +880,11 @@ void Input::ResetDefaultValue() {
 
 bool Input::SetupLink() {
   convertedData.reset();
-  if (auto p = Processor::Get(linkedOutput.processor)) {
-    auto linkedData = p->GetOutputs()[linkedOutput.data_index].get();
+  if (auto linkedData = GetLinkedData()) {
     if (!CanLink(linkedData->signature, signature)) {
       return false;
     }
-    if (linkedData->signature == signature) {
+    if (linkedData->signature == signature || CanView(linkedData->signature, signature)) {
       return true;
     }
     convertedData = linkedData->ConvertTo(signature);
@@ -264,6 +892,21 @@ bool Input::SetupLink() {
   }
 }
 
+void ReleaseGpuResources(Data& data) {
+  if (data.signature.type == Type::image) {
+    auto& image = static_cast<Image&>(data);
+    for (auto& texture : image.data) {
+      texture.reset();
+    }
+    image.damage = DamageRegion::Full();
+  }
+  if (data.signature.type == Type::buffer) {
+    for (auto& buffer : static_cast<Buffer&>(data).data) {
+      buffer.reset();
+    }
+  }
+}
+
 std::unique_ptr<Data> Data::Make(DataSignature signature) {
   switch (signature.type) {
     case Type::value: {
@@ -317,6 +960,43 @@ std::unique_ptr<Data> Data::Make(DataSignature signature) {
   return std::unique_ptr<Data>();
 }
 
+template<class DataClass>
+static std::unique_ptr<Data> CloneAs(Data const& data) {
+  auto d = std::make_unique<DataClass>();
+  d->name = data.name;
+  d->signature = data.signature;
+  d->version = data.version;
+  d->data = static_cast<DataClass const&>(data).data;
+  return d;
+}
+
+std::unique_ptr<Data> Data::Clone() const {
+  switch (signature.type) {
+    case Type::value: {
+      switch (signature.encoding) {
+        case Encoding::floating:
+          return CloneAs<Floating>(*this);
+        case Encoding::sinteger:
+          return CloneAs<SInteger>(*this);
+        case Encoding::uinteger:
+          return CloneAs<UInteger>(*this);
+      }
+    } break;
+    case Type::image: {
+      auto d = CloneAs<Image>(*this);
+      static_cast<Image&>(*d).damage = static_cast<Image const*>(this)->damage;
+      return d;
+    }
+    case Type::buffer:
+      return CloneAs<Buffer>(*this);
+    case Type::curve:
+      return CloneAs<Curve>(*this);
+    case Type::text:
+      return CloneAs<Text>(*this);
+  }
+  return std::unique_ptr<Data>();
+}
+
 template<class DataClass>
 void CopyData(Data* inData, Data const* outData) {
   auto in = static_cast<DataClass*>(inData);
@@ -349,11 +1029,41 @@ void CopyValueData(Data* inData, Data const* outData) {
   }
 }
 
+template<class DataClass>
+void CopyViewedData(Data* inData, Data const* outData) {
+  auto in = static_cast<DataClass*>(inData);
+  auto view = ValueView<typename DataClass::ElementType>{
+    static_cast<DataClass const*>(outData)->data, inData->signature.array_length, inData->signature.num_coords
+  };
+  for (uint32_t i = 0; i < view.GetArrayLength(); ++i) {
+    for (uint32_t c = 0; c < view.GetNumCoords(); ++c) {
+      in->data[i][c] = view(i, c);
+    }
+  }
+}
+
 std::unique_ptr<Data> Data::ConvertTo(DataSignature inputSignature) const {
   if (!CanLink(signature, inputSignature))
     return nullptr;
   auto inData = Data::Make(inputSignature);
 
+  if (CanView(signature, inputSignature)) {
+    // same encoding, so no element conversion: a broadcast or a truncated copy
+    if (signature.type == Type::curve) {
+      CopyViewedData<Curve>(inData.get(), this);
+    }
+    else if (signature.encoding == Encoding::floating) {
+      CopyViewedData<Floating>(inData.get(), this);
+    }
+    else if (signature.encoding == Encoding::sinteger) {
+      CopyViewedData<SInteger>(inData.get(), this);
+    }
+    else {
+      CopyViewedData<UInteger>(inData.get(), this);
+    }
+    return inData;
+  }
+
   if (signature.type == Type::value && inputSignature.type == Type::image) {
     // todo make image of 1pixel with the value
   }
@@ -407,3 +1117,136 @@ bool CanLink(DataSignature const& output, DataSignature const& input) {
 
   return true;
 }
+
+bool CanView(DataSignature const& output, DataSignature const& input) {
+  return output.type == input.type && (input.type == Type::value || input.type == Type::curve) &&
+         output.encoding == input.encoding;
+}
+
+bool Rect::Overlaps(Rect const& other) const {
+  return uint64_t(x) <= uint64_t(other.x) + other.width && uint64_t(other.x) <= uint64_t(x) + width &&
+         uint64_t(y) <= uint64_t(other.y) + other.height && uint64_t(other.y) <= uint64_t(y) + height;
+}
+
+Rect Rect::Union(Rect const& other) const {
+  if (IsEmpty()) {
+    return other;
+  }
+  if (other.IsEmpty()) {
+    return *this;
+  }
+  auto const left = std::min(x, other.x);
+  auto const top = std::min(y, other.y);
+  auto const right = std::max(uint64_t(x) + width, uint64_t(other.x) + other.width);
+  auto const bottom = std::max(uint64_t(y) + height, uint64_t(other.y) + other.height);
+  return { left,
+           top,
+           uint32_t(std::min<uint64_t>(right - left, UINT32_MAX)),
+           uint32_t(std::min<uint64_t>(bottom - top, UINT32_MAX)) };
+}
+
+Rect Rect::Expanded(uint32_t radius) const {
+  if (IsEmpty()) {
+    return *this;
+  }
+  auto const left = x > radius ? x - radius : 0;
+  auto const top = y > radius ? y - radius : 0;
+  auto const right = uint64_t(x) + width + radius;
+  auto const bottom = uint64_t(y) + height + radius;
+  return { left,
+           top,
+           uint32_t(std::min<uint64_t>(right - left, UINT32_MAX)),
+           uint32_t(std::min<uint64_t>(bottom - top, UINT32_MAX)) };
+}
+
+Rect Rect::Clipped(uint32_t max_width, uint32_t max_height) const {
+  if (x >= max_width || y >= max_height) {
+    return {};
+  }
+  return { x, y, std::min(width, max_width - x), std::min(height, max_height - y) };
+}
+
+DamageRegion DamageRegion::Full() {
+  DamageRegion region;
+  region.full = true;
+  return region;
+}
+
+bool DamageRegion::Add(Rect rect) {
+  if (full || rect.IsEmpty()) {
+    return false;
+  }
+  for (auto const& r : rects) {
+    if (r.Union(rect) == r) {
+      return false;
+    }
+  }
+  // merge with everything the rect touches, repeating since the grown rect can reach further ones
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (auto it = rects.begin(); it != rects.end(); ++it) {
+      if (it->Overlaps(rect)) {
+        rect = rect.Union(*it);
+        rects.erase(it);
+        merged = true;
+        break;
+      }
+    }
+  }
+  rects.push_back(rect);
+  if (rects.size() > max_rects) {
+    auto bounds = Rect{};
+    for (auto const& r : rects) {
+      bounds = bounds.Union(r);
+    }
+    rects = { bounds };
+  }
+  return true;
+}
+
+bool DamageRegion::Merge(DamageRegion const& other) {
+  if (full) {
+    return false;
+  }
+  if (other.full) {
+    full = true;
+    rects.clear();
+    return true;
+  }
+  bool grew = false;
+  for (auto const& rect : other.rects) {
+    grew |= Add(rect);
+  }
+  return grew;
+}
+
+DamageRegion DamageRegion::Expanded(uint32_t radius) const {
+  if (full) {
+    return Full();
+  }
+  DamageRegion region;
+  for (auto const& rect : rects) {
+    region.Add(rect.Expanded(radius));
+  }
+  return region;
+}
+
+std::vector<Rect> DamageRegion::Clipped(uint32_t width, uint32_t height) const {
+  if (full) {
+    return { Rect{ 0, 0, width, height } };
+  }
+  std::vector<Rect> clipped;
+  for (auto const& rect : rects) {
+    auto c = rect.Clipped(width, height);
+    if (!c.IsEmpty()) {
+      clipped.push_back(c);
+    }
+  }
+  return clipped;
+}
+
+void DamageRegion::Clear() {
+  full = false;
+  rects.clear();
+}
@@ -4,18 +4,22 @@
  * Distriuted under the GNU Affero General Public License.
  */
 
+#pragma once
+
 #include "app.h"
+#include "readback.h"
+#include "value_view.h"
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 using ProcessorId = uint64_t;
 using LinkId = uint64_t;
 constexpr inline ProcessorId UNLINKED = 0;
-
-using TextureRef = std::shared_ptr<wgpu::raii::Texture>;
-using BufferRef = std::shared_ptr<wgpu::raii::Buffer>;
+constexpr inline LinkId NO_LINK = 0;
 
 enum class Type {
   value,
@@ -37,15 +41,65 @@ struct DataSignature {
 };
 
 bool CanLink(DataSignature const& output, DataSignature const& input);
+// whether an input can read the output through a ValueView, rather than a converted copy
+bool CanView(DataSignature const& output, DataSignature const& input);
+
+struct Rect {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  bool IsEmpty() const { return width == 0 || height == 0; }
+  bool Overlaps(Rect const& other) const;
+  Rect Union(Rect const& other) const;
+  Rect Expanded(uint32_t radius) const;
+  Rect Clipped(uint32_t max_width, uint32_t max_height) const;
+
+  bool operator==(Rect const&) const = default;
+};
+
+// The part of an image that changed since it was last rendered. Overlapping rects are merged, and past
+// max_rects the region collapses to its bounding box, so that a render pass never needs more than a few scissors.
+struct DamageRegion {
+  static constexpr size_t max_rects = 8;
+
+  std::vector<Rect> rects;
+  bool full = false;
+
+  static DamageRegion Full();
+
+  bool IsEmpty() const { return !full && rects.empty(); }
+  bool Add(Rect rect);
+  bool Merge(DamageRegion const& other);
+  DamageRegion Expanded(uint32_t radius) const;
+  std::vector<Rect> Clipped(uint32_t width, uint32_t height) const;
+  void Clear();
+};
+
+// How a processor maps damage on its inputs to damage on its outputs.
+enum class DamageExpansion {
+  pointwise, // each output pixel depends on the same input pixel
+  radius,    // each output pixel depends on the input pixels within a radius, e.g. a blur
+  full,      // any input change affects the whole output
+};
 
 struct Data {
   std::string name;
   DataSignature signature;
+  uint64_t version = NextVersion(); // unique across all data, changes whenever the content does
+
+  void Touch() { version = NextVersion(); }
+  static uint64_t NextVersion() { return ++version_count; }
 
   static std::unique_ptr<Data> Make(DataSignature signature);
+  std::unique_ptr<Data> Clone() const; // textures and buffers are shared with the clone
   std::unique_ptr<Data> ConvertTo(DataSignature inputSignature) const;
 
   virtual ~Data() = default;
+
+private:
+  static inline std::atomic<uint64_t> version_count = 0;
 };
 
 template<class ValueDataClass>
@@ -54,12 +108,19 @@ struct TData : Data {
   std::vector<ValueType> data;
 };
 
-struct Image : TData<TextureRef> {};
+struct Image : TData<TextureRef> {
+  DamageRegion damage = DamageRegion::Full();
+};
 
 struct Buffer : TData<BufferRef> {};
 
 struct Text : TData<std::string> {};
 
+// Reads back the textures of an image or the buffers of a buffer, for CPU processors.
+std::vector<ReadbackFuture> ReadBackData(Data const& data);
+// drops the textures and buffers of the data, so that its processor allocates new ones
+void ReleaseGpuResources(Data& data);
+
 template<class ElementTypeClass>
 struct VecData : TData<std::vector<typename ElementTypeClass>> {
 
@@ -91,16 +152,40 @@ struct Curve : VecData<CurvePoints> {};
 struct DataAddress {
   ProcessorId processor = UNLINKED;
   uint32_t data_index = 0;
+
+  bool operator==(DataAddress const&) const = default;
+};
+
+enum class LinkType {
+  immediate,      // the input waits for the output to be processed
+  previous_frame, // the input reads the output as it was at the end of the previous frame, allowing feedback loops
 };
 
 struct Input {
   std::string name;
   DataSignature signature;
   DataAddress linkedOutput;
+  LinkType link_type = LinkType::immediate;
   std::unique_ptr<Data> default_value{};
-  std::unique_ptr<Data> convertedData{};
+  // for viewed links, made only when GetInputData is called, and remade when the linked data changes
+  mutable std::unique_ptr<Data> convertedData{};
+  mutable uint64_t converted_version = 0;
 
+  bool IsImmediatelyLinked() const { return linkedOutput.processor != UNLINKED && link_type == LinkType::immediate; }
+  Data* GetLinkedData() const; // before conversion, nullptr if unlinked
   Data* GetInputData() const;
+
+  // Value or curve data with the signature of the input. Links that differ only in array length or number of
+  // coordinates are read in place, so readers that use this rather than GetInputData never copy them.
+  template<class DataClass>
+  ValueView<typename DataClass::ElementType> GetView() const {
+    auto linked = GetLinkedData();
+    auto data = linked && CanView(linked->signature, signature) ? linked : GetInputData();
+    if (!data) {
+      return {};
+    }
+    return { static_cast<DataClass const*>(data)->data, signature.array_length, signature.num_coords };
+  }
   void ResetDefaultValue();
   bool SetupLink();
 };
@@ -141,6 +226,8 @@ public:
   virtual void OnInputChanged() {}
   virtual void OnOutputChanged() {}
   virtual bool CanProcess() const;
+  virtual bool ReadsGpuDataOnCpu() const { return false; }
+  virtual bool RunsOnGpu() const { return false; }
 
   void AddInput(Input in);
   void AddOutput(std::unique_ptr<Data> out);
@@ -150,52 +237,110 @@ public:
   void MoveOuput(uint32_t prev_index, uint32_t new_index);
   void SetInput(uint32_t index, Input in);
   void SetOutput(uint32_t index, std::unique_ptr<Data> out);
-  void AddInputLink(uint32_t input_index, DataAddress linkedOutput);
+  void AddInputLink(uint32_t input_index, DataAddress linkedOutput, LinkType link_type = LinkType::immediate);
   void AddOutputLink(uint32_t output_index, DataAddress linkedInput);
+  void RemoveInputLink(uint32_t input_index);
+  void RemoveOutputLink(uint32_t output_index, DataAddress linkedInput);
+  void AddPreviousFrameLink(uint32_t output_index);
+  void RemovePreviousFrameLink(uint32_t output_index);
+  // the output as it was at the end of the previous frame, whether or not the processor already ran in this one
+  Data* GetPreviousFrameOutput(uint32_t output_index) const;
+  void BeginFrame();
+  void Run();
   bool NeedsUpdate();
   void SetNeedsUpdate();
+  void SetNeedsUpdate(DamageRegion const& input_damage);
+  virtual DamageRegion ExpandDamage(DamageRegion const& input_damage) const { return DamageRegion::Full(); }
+  void ClearDamage();
+  void TouchOutputs();
   bool HasLinkedInputs();
-
-  std::vector<std::unique_ptr<Data>> const& GetOutputs() const { return outputs; }
+  bool PrepareReadbacks();
+  void ClearReadbacks();
+  bool IsEvicted() const { return evicted; }
+  bool CanEvict() const;
+  void EvictGpuOutputs();
+  bool AnyClientNeedsUpdate() const;
+  // Records the processor for the next GraphSnapshot::Capture. The methods that edit a processor call it, editors
+  // that change the default value of an input in place must call it themselves.
+  void MarkEdited();
+
+  // while an EvaluationState is bound to the thread, outputs and readbacks are the ones of that evaluation
+  std::vector<std::unique_ptr<Data>> const& GetOutputs() const;
   std::vector<Input> const& GetInputs() const { return inputs; }
   std::map<uint32_t, std::vector<DataAddress>> const& GetOutputLinks() const { return outputLinks; }
+  std::vector<ReadbackFuture> const& GetReadbacks(uint32_t input_index) const;
 
 protected:
   Processor();
   Processor(ProcessorId id);
 
+  // what Process writes to
+  std::vector<std::unique_ptr<Data>>& GetMutableOutputs();
+
   std::vector<Input> inputs;
   std::vector<std::unique_ptr<Data>> outputs;
   std::map<uint32_t, std::vector<DataAddress>> outputLinks;
+  std::vector<std::vector<ReadbackFuture>> readbacks;
 
 private:
+  friend class GraphSnapshot;
+
+  // Double buffered outputs, for previous frame links. When the processor runs, the last output is kept and the
+  // processor renders into the resources of the one before.
+  struct PreviousOutput {
+    std::unique_ptr<Data> data;
+    uint32_t num_links = 0;
+    bool kept_this_frame = false;
+  };
+
+  void KeepPreviousOutputs();
+
   static inline ProcessorId count = 0;
+  // declared first, so that it outlives the processors, whose destructors insert into it
+  static inline std::set<ProcessorId> edited;
   static inline std::map<ProcessorId, std::unique_ptr<Processor>> processors;
   bool needs_update{ true };
+  bool processing{ false };
+  bool evicted{ false };
+  std::map<uint32_t, PreviousOutput> previous_outputs;
 };
 
 class PixelProcessor : public Processor {
 public:
   PixelProcessor();
   void Process() override;
+  bool RunsOnGpu() const override { return true; }
+  DamageRegion ExpandDamage(DamageRegion const& input_damage) const override;
+  void SetDamageExpansion(DamageExpansion expansion, uint32_t radius = 0);
+  bool IsFullyDamaged(uint32_t output_index) const;
+  void DrawDamaged(wgpu::RenderPassEncoder pass,
+                   uint32_t output_index,
+                   std::function<void(wgpu::RenderPassEncoder)> const& draw) const;
+
+private:
+  DamageExpansion damage_expansion = DamageExpansion::pointwise;
+  uint32_t damage_radius = 0;
 };
 
 class ComputeProcessor : public Processor {
 public:
   ComputeProcessor();
   void Process() override;
+  bool RunsOnGpu() const override { return true; }
 };
 
 class ImageReader : public Processor {
 public:
   ImageReader();
   void Process() override;
+  bool RunsOnGpu() const override { return true; }
 };
 
 class ScriptProcessor : public Processor {
 public:
   ScriptProcessor();
   void Process() override;
+  bool ReadsGpuDataOnCpu() const override { return true; }
 };
 
 using BuiltinProcessingCall = std::function<void(std::vector<Input> const&, std::vector<std::unique_ptr<Data>>&)>;
@@ -205,33 +350,60 @@ public:
   BuiltinProcessor();
   void SetProcessingCall(BuiltinProcessingCall call);
   void Process() override;
+  bool ReadsGpuDataOnCpu() const override { return true; }
 
 private:
   BuiltinProcessingCall process_call{};
 };
 
+class GraphSnapshot;
+
 class Graph {
 public:
   void Execute();
-  LinkId CreateLink(DataAddress output, DataAddress input);
+  // NO_LINK if an immediate link would close a cycle. Previous frame links never do, as they do not order processors.
+  LinkId CreateLink(DataAddress output, DataAddress input, LinkType link_type = LinkType::immediate);
   void RemoveLink(LinkId link_id);
+  // Brings the processors that differ from the snapshot back to it. Processors created or destroyed since it was
+  // captured are left as they are. The links of the restored processors get new ids.
+  void Restore(GraphSnapshot const& snapshot);
+  // The linked processors in topological order, kept up to date by every link edit.
+  std::vector<ProcessorId> const& GetOrder() const { return order; }
 
 private:
   struct LinkData {
     DataAddress output;
     DataAddress input;
+    LinkType link_type = LinkType::immediate;
+    uint64_t read_version = 0; // of the previous frame output, last time the input was marked for update
   };
+
+  void BeginFrame();
+
+  uint32_t GetOrderIndex(ProcessorId id);
+  bool InsertInOrder(ProcessorId from, ProcessorId to);
+  void RebuildOrder();
+
   std::map<LinkId, LinkData> links;
   std::vector<ProcessorId> processors;
   std::set<ProcessorId> no_input_processors;
   LinkId linkCount = 0;
+  std::vector<ProcessorId> order;
+  std::unordered_map<ProcessorId, uint32_t> order_index;
 };
 
 class GroupProcessor : public Processor {
 public:
   GroupProcessor();
-  void Process() override { graph.Execute(); }
+  // Instances of the same template with the same inputs are evaluated once per frame: the first one runs its graph,
+  // the others share its outputs.
+  void Process() override;
+  // its graph may hold any processor, and is evaluated on its live state
+  bool RunsOnGpu() const override { return true; }
 
 private:
+  bool TakeMemoizedOutputs(ProcessorId evaluated_by);
+  void ReleaseSharedOutputs();
+
   Graph graph;
 };
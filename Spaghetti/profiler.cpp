@@ -0,0 +1,203 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "profiler.h"
+#include "imgui.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+static std::string GetProcessorName(ProcessorId id) {
+  auto p = Processor::Get(id);
+  if (p && !p->display_name.empty()) {
+    return p->display_name;
+  }
+  return "#" + std::to_string(id);
+}
+
+Profiler& Profiler::Get() {
+  static Profiler profiler{};
+  return profiler;
+}
+
+double Profiler::Now() {
+  static auto const start = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+Profiler::Profiler() {
+  if (App::Get().SupportsTimestampQuery()) {
+    wgpu::QuerySetDescriptor desc = wgpu::Default;
+    desc.label = { "Profiler timestamps", WGPU_STRLEN };
+    desc.type = wgpu::QueryType::Timestamp;
+    desc.count = 2 * max_passes_per_frame;
+    query_set = { Gpu().createQuerySet(desc) };
+    for (auto& frame : frames) {
+      wgpu::BufferDescriptor buffer_desc = {};
+      buffer_desc.label = { "Profiler timestamps resolve buffer", WGPU_STRLEN };
+      buffer_desc.size = 2 * max_passes_per_frame * sizeof(uint64_t);
+      buffer_desc.usage = wgpu::BufferUsage::QueryResolve | wgpu::BufferUsage::CopySrc;
+      buffer_desc.mappedAtCreation = false;
+      frame.resolve = std::make_shared<wgpu::raii::Buffer>(Gpu().createBuffer(buffer_desc));
+    }
+    timestamp_writes.resize(max_passes_per_frame);
+  }
+  App::Get().onNewFrame.push_back([this] { BeginFrame(); });
+}
+
+void Profiler::BeginFrame() {
+  CollectReadbacks();
+  if (!query_set) {
+    return;
+  }
+  auto& frame = frames[current_frame];
+  if (recording && !frame.processors.empty()) {
+    wgpu::raii::CommandEncoder encoder = { Gpu().createCommandEncoder() };
+    encoder->resolveQuerySet(*query_set, 0, uint32_t(2 * frame.processors.size()), **frame.resolve, 0);
+    wgpu::raii::CommandBuffer command = { encoder->finish() };
+    GpuQueue().submit(1, &*command);
+    frame.readback = ReadbackRing::Get().Read(frame.resolve);
+    current_frame = (current_frame + 1) % num_frames;
+  }
+  // a frame slot is reused only after its results were collected, otherwise this frame goes unmeasured
+  auto& next = frames[current_frame];
+  recording = enabled && !next.readback;
+  if (recording) {
+    next.processors.clear();
+    next.cpu_begin_us = Now();
+  }
+}
+
+WGPUPassTimestampWrites const* Profiler::GetTimestampWrites(ProcessorId processor) {
+  if (!recording) {
+    return nullptr;
+  }
+  auto& frame = frames[current_frame];
+  if (frame.processors.size() >= max_passes_per_frame) {
+    return nullptr;
+  }
+  auto const index = uint32_t(frame.processors.size());
+  frame.processors.push_back(processor);
+  auto& writes = timestamp_writes[index];
+  writes = wgpu::Default;
+  writes.querySet = *query_set;
+  writes.beginningOfPassWriteIndex = 2 * index;
+  writes.endOfPassWriteIndex = 2 * index + 1;
+  return &writes;
+}
+
+void Profiler::CollectReadbacks() {
+  for (auto& frame : frames) {
+    if (!frame.readback || !frame.readback->ready) {
+      continue;
+    }
+    auto const& bytes = frame.readback->bytes;
+    if (!frame.readback->failed && bytes.size() >= 2 * frame.processors.size() * sizeof(uint64_t)) {
+      std::vector<uint64_t> stamps(2 * frame.processors.size());
+      std::memcpy(stamps.data(), bytes.data(), stamps.size() * sizeof(uint64_t));
+      // gpu timestamps have their own time base, the trace aligns the first pass with the start of its frame
+      auto const first = stamps.empty() ? 0 : stamps[0];
+      for (size_t i = 0; i < frame.processors.size(); ++i) {
+        auto const begin = stamps[2 * i];
+        auto const end = stamps[2 * i + 1];
+        if (end < begin || begin < first) {
+          continue;
+        }
+        auto const duration_us = double(end - begin) / 1000.0;
+        auto& timing = timings[frame.processors[i]];
+        timing.gpu_ms = smoothing * timing.gpu_ms + (1.0 - smoothing) * duration_us / 1000.0;
+        auto const begin_us = frame.cpu_begin_us + double(begin - first) / 1000.0;
+        trace.push_back({ frame.processors[i], true, begin_us, duration_us });
+      }
+    }
+    frame.readback.reset();
+    frame.processors.clear();
+  }
+  while (trace.size() > max_trace_events) {
+    trace.pop_front();
+  }
+}
+
+void Profiler::RecordCpuTime(ProcessorId processor, double begin_us, double end_us) {
+  if (!enabled) {
+    return;
+  }
+  auto const duration_us = end_us - begin_us;
+  auto& timing = timings[processor];
+  timing.cpu_ms = smoothing * timing.cpu_ms + (1.0 - smoothing) * duration_us / 1000.0;
+  trace.push_back({ processor, false, begin_us, duration_us });
+  if (trace.size() > max_trace_events) {
+    trace.pop_front();
+  }
+}
+
+void Profiler::DrawOverlay(bool* open) {
+  if (!ImGui::Begin("Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+  ImGui::Checkbox("Enabled", &enabled);
+  ImGui::SameLine();
+  if (ImGui::Button("Export trace")) {
+    ExportTrace("spaghetti_trace.json");
+  }
+  if (!HasGpuTimestamps()) {
+    ImGui::TextDisabled("Timestamp queries are not supported by the adapter, showing CPU timings only.");
+  }
+
+  auto ranking = std::vector<std::pair<ProcessorId, ProcessorTiming>>(timings.begin(), timings.end());
+  std::sort(ranking.begin(), ranking.end(), [](auto const& a, auto const& b) {
+    if (a.second.gpu_ms != b.second.gpu_ms) {
+      return a.second.gpu_ms > b.second.gpu_ms;
+    }
+    return a.second.cpu_ms > b.second.cpu_ms;
+  });
+
+  if (ImGui::BeginTable("Timings", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupColumn("Processor");
+    ImGui::TableSetupColumn("GPU ms");
+    ImGui::TableSetupColumn("CPU ms");
+    ImGui::TableHeadersRow();
+    for (auto const& [id, timing] : ranking) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(GetProcessorName(id).c_str());
+      ImGui::TableNextColumn();
+      if (HasGpuTimestamps()) {
+        ImGui::Text("%.3f", timing.gpu_ms);
+      }
+      else {
+        ImGui::TextDisabled("-");
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", timing.cpu_ms);
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
+
+bool Profiler::ExportTrace(std::string const& path) const {
+  // chrome://tracing and Perfetto format, cpu events on thread 0 and gpu events on thread 1
+  auto events = nlohmann::json::array();
+  for (auto const& event : trace) {
+    events.push_back({ { "name", GetProcessorName(event.processor) },
+                       { "cat", event.gpu ? "gpu" : "cpu" },
+                       { "ph", "X" },
+                       { "ts", event.begin_us },
+                       { "dur", event.duration_us },
+                       { "pid", 0 },
+                       { "tid", event.gpu ? 1 : 0 } });
+  }
+  auto file = std::ofstream(path);
+  if (!file) {
+    return false;
+  }
+  file << nlohmann::json{ { "traceEvents", std::move(events) } }.dump();
+  return bool(file);
+}
@@ -0,0 +1,72 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <array>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+struct ProcessorTiming {
+  double cpu_ms = 0.0;
+  double gpu_ms = 0.0;
+};
+
+// Times each processor on the CPU and, when the device has TimestampQuery, each of its GPU passes. GPU processors
+// pass GetTimestampWrites to their render or compute pass descriptor. At the start of the next frame the queries are
+// resolved and read back through the ReadbackRing, so timings show up a few frames late but never stall.
+class Profiler final {
+public:
+  static Profiler& Get();
+  static double Now(); // microseconds
+
+  void SetEnabled(bool enabled) { this->enabled = enabled; }
+  bool IsEnabled() const { return enabled; }
+  bool HasGpuTimestamps() const { return query_set; }
+
+  WGPUPassTimestampWrites const* GetTimestampWrites(ProcessorId processor);
+  void RecordCpuTime(ProcessorId processor, double begin_us, double end_us);
+
+  std::unordered_map<ProcessorId, ProcessorTiming> const& GetTimings() const { return timings; }
+  void DrawOverlay(bool* open);
+  bool ExportTrace(std::string const& path) const;
+
+private:
+  Profiler();
+
+  void BeginFrame();
+  void CollectReadbacks();
+
+  struct FrameQueries {
+    BufferRef resolve;
+    std::vector<ProcessorId> processors; // pass i wrote queries 2 * i and 2 * i + 1
+    ReadbackFuture readback;
+    double cpu_begin_us = 0.0;
+  };
+
+  struct TraceEvent {
+    ProcessorId processor;
+    bool gpu;
+    double begin_us;
+    double duration_us;
+  };
+
+  static constexpr uint32_t max_passes_per_frame = 256;
+  static constexpr uint32_t num_frames = 4;
+  static constexpr size_t max_trace_events = 1 << 16;
+  static constexpr double smoothing = 0.9;
+
+  bool enabled = true;
+  wgpu::raii::QuerySet query_set{};
+  std::array<FrameQueries, num_frames> frames;
+  uint32_t current_frame = 0;
+  bool recording = false;
+  std::vector<wgpu::PassTimestampWrites> timestamp_writes;
+  std::unordered_map<ProcessorId, ProcessorTiming> timings;
+  std::deque<TraceEvent> trace;
+};
@@ -0,0 +1,167 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "readback.h"
+#include <cstring>
+
+static constexpr uint32_t bytes_per_row_alignment = 256;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t BytesPerTexel(wgpu::TextureFormat format) {
+  switch (format) {
+    case wgpu::TextureFormat::R8Unorm:
+      return 1;
+    case wgpu::TextureFormat::RG8Unorm:
+    case wgpu::TextureFormat::R16Float:
+      return 2;
+    case wgpu::TextureFormat::RGBA8Unorm:
+    case wgpu::TextureFormat::RGBA8UnormSrgb:
+    case wgpu::TextureFormat::BGRA8Unorm:
+    case wgpu::TextureFormat::BGRA8UnormSrgb:
+    case wgpu::TextureFormat::R32Float:
+    case wgpu::TextureFormat::R32Uint:
+    case wgpu::TextureFormat::R32Sint:
+    case wgpu::TextureFormat::RG16Float:
+      return 4;
+    case wgpu::TextureFormat::RGBA16Float:
+    case wgpu::TextureFormat::RG32Float:
+      return 8;
+    case wgpu::TextureFormat::RGBA32Float:
+    case wgpu::TextureFormat::RGBA32Uint:
+    case wgpu::TextureFormat::RGBA32Sint:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+ReadbackRing& ReadbackRing::Get() {
+  static ReadbackRing ring{};
+  return ring;
+}
+
+ReadbackRing::ReadbackRing()
+  : slots(initial_num_slots) {
+  App::Get().onNewFrame.push_back([this] { Pump(); });
+}
+
+ReadbackFuture ReadbackRing::Read(TextureRef const& texture) {
+  auto data = std::make_shared<ReadbackData>();
+  if (!texture || !*texture || BytesPerTexel((*texture)->getFormat()) == 0) {
+    data->failed = true;
+    data->ready = true;
+    return data;
+  }
+  data->format = (*texture)->getFormat();
+  data->width = (*texture)->getWidth();
+  data->height = (*texture)->getHeight();
+  auto const row_size = data->width * BytesPerTexel((*texture)->getFormat());
+  data->bytes_per_row = uint32_t(AlignUp(row_size, bytes_per_row_alignment));
+  Start(GetFreeSlot(), { texture, nullptr, data });
+  return data;
+}
+
+ReadbackFuture ReadbackRing::Read(BufferRef const& buffer) {
+  auto data = std::make_shared<ReadbackData>();
+  if (!buffer || !*buffer) {
+    data->failed = true;
+    data->ready = true;
+    return data;
+  }
+  Start(GetFreeSlot(), { nullptr, buffer, data });
+  return data;
+}
+
+void ReadbackRing::Pump() {
+  App::Get().ProcessGpuEvents();
+}
+
+size_t ReadbackRing::GetNumInFlight() const {
+  size_t count = 0;
+  for (auto const& slot : slots) {
+    if (slot.data) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+uint32_t ReadbackRing::GetFreeSlot() {
+  for (uint32_t i = 0; i < slots.size(); ++i) {
+    if (!slots[i].data) {
+      return i;
+    }
+  }
+  slots.emplace_back();
+  return uint32_t(slots.size() - 1);
+}
+
+void ReadbackRing::Start(uint32_t slot_index, Request request) {
+  auto& slot = slots[slot_index];
+  auto const size = request.texture ? uint64_t(request.data->bytes_per_row) * request.data->height
+                                    : (*request.buffer)->getSize();
+
+  if (slot.capacity < size) {
+    wgpu::BufferDescriptor desc = {};
+    desc.label = { "Readback staging buffer", WGPU_STRLEN };
+    desc.size = AlignUp(size, bytes_per_row_alignment);
+    desc.usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst;
+    desc.mappedAtCreation = false;
+    slot.staging = { Gpu().createBuffer(desc) };
+    slot.capacity = desc.size;
+  }
+  slot.data = request.data;
+
+  wgpu::raii::CommandEncoder encoder = { Gpu().createCommandEncoder() };
+  if (request.texture) {
+    wgpu::TexelCopyTextureInfo source = wgpu::Default;
+    source.texture = **request.texture;
+    wgpu::TexelCopyBufferInfo destination = wgpu::Default;
+    destination.buffer = *slot.staging;
+    destination.layout.offset = 0;
+    destination.layout.bytesPerRow = request.data->bytes_per_row;
+    destination.layout.rowsPerImage = request.data->height;
+    wgpu::Extent3D extent = wgpu::Default;
+    extent.width = request.data->width;
+    extent.height = request.data->height;
+    extent.depthOrArrayLayers = 1;
+    encoder->copyTextureToBuffer(source, destination, extent);
+  }
+  else {
+    encoder->copyBufferToBuffer(**request.buffer, 0, *slot.staging, 0, size);
+  }
+  wgpu::raii::CommandBuffer command = { encoder->finish() };
+  GpuQueue().submit(1, &*command);
+
+  slot.staging->mapAsync(wgpu::MapMode::Read,
+                         0,
+                         size,
+                         wgpu::CallbackMode::AllowProcessEvents,
+                         [this, slot_index, size](wgpu::MapAsyncStatus status, auto) {
+                           OnMapped(slot_index, status == wgpu::MapAsyncStatus::Success, size);
+                         });
+}
+
+void ReadbackRing::OnMapped(uint32_t slot_index, bool success, uint64_t size) {
+  auto& slot = slots[slot_index];
+  auto data = std::move(slot.data);
+  if (!data) {
+    return;
+  }
+  if (success) {
+    data->bytes.resize(size);
+    auto mapped = slot.staging->getConstMappedRange(0, size);
+    std::memcpy(data->bytes.data(), mapped, size);
+    slot.staging->unmap();
+  }
+  else {
+    data->failed = true;
+  }
+  data->ready = true;
+}
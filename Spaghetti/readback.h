@@ -0,0 +1,67 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "app.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using TextureRef = std::shared_ptr<wgpu::raii::Texture>;
+using BufferRef = std::shared_ptr<wgpu::raii::Buffer>;
+
+struct ReadbackData {
+  std::atomic<bool> ready{ false };
+  bool failed = false;
+  // set for texture readbacks, rows are padded to bytes_per_row
+  wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytes_per_row = 0;
+  std::vector<uint8_t> bytes;
+};
+
+using ReadbackFuture = std::shared_ptr<ReadbackData const>;
+
+// Copies textures and buffers into a ring of mappable staging buffers and maps them asynchronously. Map callbacks
+// are delivered by Pump, which runs once per frame from the main loop; nothing here ever waits on the GPU.
+// The copy is recorded as soon as Read is called, so the result holds the content at that point of the queue: when
+// every slot is in flight the ring grows rather than deferring the copy.
+class ReadbackRing final {
+public:
+  static ReadbackRing& Get();
+
+  ReadbackFuture Read(TextureRef const& texture);
+  ReadbackFuture Read(BufferRef const& buffer);
+  void Pump();
+  size_t GetNumInFlight() const;
+
+private:
+  ReadbackRing();
+
+  struct Request {
+    TextureRef texture;
+    BufferRef buffer;
+    std::shared_ptr<ReadbackData> data;
+  };
+
+  struct Slot {
+    wgpu::raii::Buffer staging{};
+    uint64_t capacity = 0;
+    std::shared_ptr<ReadbackData> data;
+  };
+
+  uint32_t GetFreeSlot();
+  void Start(uint32_t slot_index, Request request);
+  void OnMapped(uint32_t slot_index, bool success, uint64_t size);
+
+  static constexpr uint32_t initial_num_slots = 8;
+  std::vector<Slot> slots;
+};
+
+uint32_t BytesPerTexel(wgpu::TextureFormat format);
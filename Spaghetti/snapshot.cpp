@@ -0,0 +1,122 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "snapshot.h"
+
+GraphSnapshot& GraphSnapshot::GetLatest() {
+  static GraphSnapshot latest{};
+  return latest;
+}
+
+GraphSnapshot GraphSnapshot::Capture() {
+  auto& latest = GetLatest();
+  for (auto id : Processor::edited) {
+    auto p = Processor::Get(id);
+    if (!p) {
+      latest.processors = latest.processors.Erase(id);
+      continue;
+    }
+    auto previous = latest.processors.Find(id);
+    latest.processors = latest.processors.Set(id, Capture(*p, previous ? previous->get() : nullptr));
+  }
+  Processor::edited.clear();
+  return latest;
+}
+
+std::shared_ptr<ProcessorSnapshot const> GraphSnapshot::Find(ProcessorId id) const {
+  auto p = processors.Find(id);
+  return p ? *p : nullptr;
+}
+
+std::shared_ptr<ProcessorSnapshot const> GraphSnapshot::Capture(Processor const& p, ProcessorSnapshot const* previous) {
+  auto snapshot = std::make_shared<ProcessorSnapshot>();
+  snapshot->id = p.id;
+  snapshot->display_name = p.display_name;
+  snapshot->template_name = p.template_name;
+  for (size_t i = 0; i < p.GetInputs().size(); ++i) {
+    auto const& in = p.GetInputs()[i];
+    auto& s = snapshot->inputs.emplace_back();
+    s.name = in.name;
+    s.signature = in.signature;
+    s.linkedOutput = in.linkedOutput;
+    s.link_type = in.link_type;
+    if (!in.default_value) {
+      continue;
+    }
+    // unchanged values are shared with the previous snapshot
+    auto const previous_value = previous && i < previous->inputs.size() ? previous->inputs[i].default_value : nullptr;
+    if (previous_value && previous_value->version == in.default_value->version) {
+      s.default_value = previous_value;
+    }
+    else {
+      s.default_value = in.default_value->Clone();
+    }
+  }
+  for (auto const& out : p.GetOutputs()) {
+    snapshot->outputs.push_back(out ? out->signature : DataSignature{});
+  }
+  snapshot->outputLinks = p.GetOutputLinks();
+  return snapshot;
+}
+
+void GraphSnapshot::Restore(Processor& p, ProcessorSnapshot const& snapshot) {
+  p.display_name = snapshot.display_name;
+  p.template_name = snapshot.template_name;
+  p.inputs.resize(snapshot.inputs.size());
+  for (size_t i = 0; i < snapshot.inputs.size(); ++i) {
+    auto& in = p.inputs[i];
+    auto const& s = snapshot.inputs[i];
+    in.name = s.name;
+    in.signature = s.signature;
+    in.linkedOutput = s.linkedOutput;
+    in.link_type = s.link_type;
+    if (!s.default_value) {
+      in.default_value.reset();
+    }
+    else if (!in.default_value || in.default_value->version != s.default_value->version) {
+      in.default_value = s.default_value->Clone();
+    }
+    if (in.linkedOutput.processor != UNLINKED) {
+      in.SetupLink();
+    }
+    else {
+      in.convertedData.reset();
+    }
+  }
+  p.outputs.resize(snapshot.outputs.size());
+  for (size_t i = 0; i < snapshot.outputs.size(); ++i) {
+    if (!p.outputs[i] || !(p.outputs[i]->signature == snapshot.outputs[i])) {
+      p.outputs[i] = Data::Make(snapshot.outputs[i]);
+    }
+  }
+  p.outputLinks = snapshot.outputLinks;
+  p.SetNeedsUpdate();
+}
+
+void UndoHistory::Push(GraphSnapshot snapshot) {
+  snapshots.resize(position);
+  snapshots.push_back(std::move(snapshot));
+  if (snapshots.size() > max_size) {
+    snapshots.pop_front();
+  }
+  position = snapshots.size();
+}
+
+GraphSnapshot const* UndoHistory::Undo() {
+  if (!CanUndo()) {
+    return nullptr;
+  }
+  --position;
+  return &snapshots[position - 1];
+}
+
+GraphSnapshot const* UndoHistory::Redo() {
+  if (!CanRedo()) {
+    return nullptr;
+  }
+  ++position;
+  return &snapshots[position - 1];
+}
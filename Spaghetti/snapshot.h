@@ -0,0 +1,82 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "persistent_map.h"
+#include "processor.h"
+#include <deque>
+
+struct InputSnapshot {
+  std::string name;
+  DataSignature signature;
+  DataAddress linkedOutput;
+  LinkType link_type = LinkType::immediate;
+  std::shared_ptr<Data const> default_value;
+};
+
+// What editing changes in a processor: its links and its parameter values. Never modified once captured.
+struct ProcessorSnapshot {
+  ProcessorId id = UNLINKED;
+  std::string display_name;
+  std::string template_name;
+  std::vector<InputSnapshot> inputs;
+  std::vector<DataSignature> outputs;
+  std::map<uint32_t, std::vector<DataAddress>> outputLinks;
+};
+
+// An immutable view of all processors, safe to read from any thread, e.g. for undo or by a background evaluation.
+// Capture starts from the previous snapshot and recaptures only the processors edited since, so consecutive
+// snapshots share all the rest, including the values of the parameters that did not change.
+class GraphSnapshot final {
+public:
+  static GraphSnapshot Capture();
+
+  std::shared_ptr<ProcessorSnapshot const> Find(ProcessorId id) const;
+  size_t GetNumProcessors() const { return processors.GetSize(); }
+
+  template<class Callback>
+  void ForEach(Callback const& callback) const {
+    processors.ForEach([&](ProcessorId, std::shared_ptr<ProcessorSnapshot const> const& p) { callback(*p); });
+  }
+
+  // callback(processor in this or nullptr, processor in other or nullptr) for the processors that differ
+  template<class Callback>
+  void Diff(GraphSnapshot const& other, Callback const& callback) const {
+    processors.Diff(other.processors, [&](ProcessorId, auto const* a, auto const* b) {
+      callback(a ? a->get() : nullptr, b ? b->get() : nullptr);
+    });
+  }
+
+private:
+  friend class Graph;
+
+  static std::shared_ptr<ProcessorSnapshot const> Capture(Processor const& p, ProcessorSnapshot const* previous);
+  static void Restore(Processor& p, ProcessorSnapshot const& snapshot);
+
+  // the live graph, as of the last Capture or Graph::Restore
+  static GraphSnapshot& GetLatest();
+
+  PersistentMap<std::shared_ptr<ProcessorSnapshot const>> processors;
+};
+
+// Snapshots to undo and redo, each costing memory proportional to its changes.
+class UndoHistory final {
+public:
+  explicit UndoHistory(size_t max_size = 1000)
+    : max_size{ max_size } {}
+
+  void Push(GraphSnapshot snapshot);
+  GraphSnapshot const* Undo();
+  GraphSnapshot const* Redo();
+  bool CanUndo() const { return position > 1; }
+  bool CanRedo() const { return position < snapshots.size(); }
+
+private:
+  std::deque<GraphSnapshot> snapshots;
+  size_t position = 0; // one past the current snapshot
+  size_t max_size;
+};
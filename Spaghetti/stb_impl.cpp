@@ -0,0 +1,8 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
@@ -0,0 +1,118 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool& ThreadPool::Get() {
+  static ThreadPool pool{ std::max(std::thread::hardware_concurrency(), 2u) - 1 };
+  return pool;
+}
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    workers.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    auto lock = std::lock_guard(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  if (workers.empty()) {
+    task();
+    return;
+  }
+  {
+    auto lock = std::lock_guard(mutex);
+    tasks.push_back(std::move(task));
+  }
+  condition.notify_one();
+}
+
+bool ThreadPool::RunPendingTask() {
+  std::function<void()> task;
+  {
+    auto lock = std::lock_guard(mutex);
+    if (tasks.empty()) {
+      return false;
+    }
+    task = std::move(tasks.front());
+    tasks.pop_front();
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      auto lock = std::unique_lock(mutex);
+      condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (stopping && tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             size_t chunk_size,
+                             std::function<void(size_t begin, size_t end)> const& body) {
+  if (count == 0) {
+    return;
+  }
+  chunk_size = std::max<size_t>(chunk_size, 1);
+  auto const num_chunks = (count + chunk_size - 1) / chunk_size;
+  if (num_chunks == 1 || workers.empty()) {
+    body(0, count);
+    return;
+  }
+
+  struct State {
+    std::atomic<size_t> next_chunk{ 0 };
+    std::atomic<size_t> num_done{ 0 };
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+  auto state = std::make_shared<State>();
+
+  // helpers that start after all chunks were taken return without touching body
+  auto work = [state, num_chunks, chunk_size, count, &body] {
+    size_t num_finished = 0;
+    for (auto chunk = state->next_chunk++; chunk < num_chunks; chunk = state->next_chunk++) {
+      body(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+      ++num_finished;
+    }
+    if (num_finished > 0 && state->num_done.fetch_add(num_finished) + num_finished == num_chunks) {
+      auto lock = std::lock_guard(state->mutex);
+      state->done.notify_all();
+    }
+  };
+
+  auto const num_helpers = std::min<size_t>(num_chunks - 1, workers.size());
+  for (size_t i = 0; i < num_helpers; ++i) {
+    Submit(work);
+  }
+  work();
+
+  auto lock = std::unique_lock(state->mutex);
+  state->done.wait(lock, [&] { return state->num_done == num_chunks; });
+}
@@ -0,0 +1,44 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool final {
+public:
+  static ThreadPool& Get();
+
+  explicit ThreadPool(uint32_t num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  void Submit(std::function<void()> task);
+  // Runs a queued task on the calling thread, for threads that wait on tasks they queued. False if there was none.
+  bool RunPendingTask();
+  // Calls body on chunks of [0, count). The calling thread works on the chunks too, so it is safe to call from a task.
+  void ParallelFor(size_t count, size_t chunk_size, std::function<void(size_t begin, size_t end)> const& body);
+  uint32_t GetNumThreads() const { return uint32_t(workers.size()); }
+
+private:
+  void WorkerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+};
@@ -0,0 +1,136 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#include "uniforms.h"
+#include <algorithm>
+#include <cstring>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static uint32_t GetElementStride(DataSignature const& signature) {
+  return uint32_t(AlignUp(signature.num_coords * 4, 16));
+}
+
+template<class ValueDataClass>
+static void PackValue(Data const& value, uint8_t* destination, uint32_t element_stride) {
+  auto const& elements = static_cast<ValueDataClass const&>(value).data;
+  for (size_t i = 0; i < elements.size(); ++i) {
+    auto const& element = elements[i];
+    auto const element_size = std::min<size_t>(element.size() * sizeof(element[0]), element_stride);
+    std::memcpy(destination + i * element_stride, element.data(), element_size);
+    std::memset(destination + i * element_stride + element_size, 0, element_stride - element_size);
+  }
+}
+
+UniformRing& UniformRing::Get() {
+  static UniformRing ring{};
+  return ring;
+}
+
+UniformRing::UniformRing() {
+  wgpu::Limits limits = wgpu::Default;
+  if (Gpu().getLimits(&limits) == wgpu::Status::Success) {
+    alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+  }
+  Reserve(initial_capacity);
+  App::Get().onNewFrame.push_back([this] { BeginFrame(); });
+}
+
+void UniformRing::BeginFrame() {
+  Flush();
+  ++frame;
+  head = 0;
+  // anything not uploaded last frame may have had its bytes reused by someone else
+  std::erase_if(packed, [&](auto const& entry) { return entry.second.frame + 1 < frame; });
+}
+
+UniformAllocation UniformRing::Upload(Data const& value) {
+  if (value.signature.type != Type::value) {
+    return {};
+  }
+  auto const element_stride = GetElementStride(value.signature);
+  auto const size = value.signature.array_length * element_stride;
+  auto const offset = AlignUp(head, alignment);
+  if (offset + size > capacity) {
+    Reserve(std::max(capacity * 2, offset + size));
+  }
+  head = offset + size;
+
+  auto& entry = packed[&value];
+  if (entry.frame != 0 && entry.offset == offset && entry.version == value.version) {
+    entry.frame = frame;
+    return { uint32_t(offset), size };
+  }
+  switch (value.signature.encoding) {
+    case Encoding::floating:
+      PackValue<Floating>(value, shadow.data() + offset, element_stride);
+      break;
+    case Encoding::sinteger:
+      PackValue<SInteger>(value, shadow.data() + offset, element_stride);
+      break;
+    case Encoding::uinteger:
+      PackValue<UInteger>(value, shadow.data() + offset, element_stride);
+      break;
+  }
+  entry = { value.version, uint32_t(offset), frame };
+  dirty_begin = std::min(dirty_begin, offset);
+  dirty_end = std::max(dirty_end, offset + size);
+  return { uint32_t(offset), size };
+}
+
+void UniformRing::Flush() {
+  if (dirty_begin >= dirty_end) {
+    return;
+  }
+  // writeBuffer needs a size multiple of 4, and every allocation is a multiple of 16
+  GpuQueue().writeBuffer(*buffer, dirty_begin, shadow.data() + dirty_begin, dirty_end - dirty_begin);
+  dirty_begin = UINT64_MAX;
+  dirty_end = 0;
+}
+
+void UniformRing::Reserve(uint64_t size) {
+  if (size <= capacity) {
+    return;
+  }
+  // commands already recorded this frame reference the old buffer, so it gets its pending values first
+  if (buffer) {
+    Flush();
+  }
+  capacity = AlignUp(size, initial_capacity);
+  shadow.resize(capacity);
+  wgpu::BufferDescriptor desc = {};
+  desc.label = { "Uniform ring buffer", WGPU_STRLEN };
+  desc.size = capacity;
+  desc.usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+  desc.mappedAtCreation = false;
+  buffer = { Gpu().createBuffer(desc) };
+  ++generation;
+  dirty_begin = 0;
+  dirty_end = head;
+}
+
+wgpu::BindGroupLayoutEntry UniformRing::GetLayoutEntry(uint32_t binding,
+                                                       WGPUShaderStage visibility,
+                                                       bool storage) const {
+  wgpu::BindGroupLayoutEntry entry = wgpu::Default;
+  entry.binding = binding;
+  entry.visibility = visibility;
+  entry.buffer.type = storage ? wgpu::BufferBindingType::ReadOnlyStorage : wgpu::BufferBindingType::Uniform;
+  entry.buffer.hasDynamicOffset = true;
+  entry.buffer.minBindingSize = 0;
+  return entry;
+}
+
+wgpu::BindGroupEntry UniformRing::GetBindGroupEntry(uint32_t binding, uint32_t size) const {
+  wgpu::BindGroupEntry entry = wgpu::Default;
+  entry.binding = binding;
+  entry.buffer = *buffer;
+  entry.offset = 0;
+  entry.size = size;
+  return entry;
+}
@@ -0,0 +1,59 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include "processor.h"
+#include <unordered_map>
+
+struct UniformAllocation {
+  uint32_t offset = 0; // the dynamic offset to pass to setBindGroup
+  uint32_t size = 0;
+};
+
+// One large uniform/storage buffer, linearly sub-allocated every frame at minUniformBufferOffsetAlignment, and bound
+// with dynamic offsets. Values are packed into a CPU shadow copy only when their version or their offset changed, and
+// Flush uploads the changed span with a single writeBuffer. Each array element is padded to 16 bytes, so that the
+// layout is valid both as array<vec4<T>> in uniform and in storage address space.
+class UniformRing final {
+public:
+  static UniformRing& Get();
+
+  UniformAllocation Upload(Data const& value);
+  void Flush();
+
+  wgpu::Buffer GetBuffer() const { return *buffer; }
+  // bumped whenever the buffer is reallocated, bind groups created with an older generation must be recreated
+  uint64_t GetGeneration() const { return generation; }
+
+  wgpu::BindGroupLayoutEntry GetLayoutEntry(uint32_t binding, WGPUShaderStage visibility, bool storage) const;
+  wgpu::BindGroupEntry GetBindGroupEntry(uint32_t binding, uint32_t size) const;
+
+private:
+  UniformRing();
+
+  void BeginFrame();
+  void Reserve(uint64_t size);
+
+  struct Packed {
+    uint64_t version = 0;
+    uint32_t offset = 0;
+    uint64_t frame = 0;
+  };
+
+  static constexpr uint64_t initial_capacity = 1 << 20;
+
+  wgpu::raii::Buffer buffer{};
+  std::vector<uint8_t> shadow;
+  uint64_t capacity = 0;
+  uint64_t head = 0;
+  uint64_t dirty_begin = UINT64_MAX;
+  uint64_t dirty_end = 0;
+  uint32_t alignment = 256;
+  uint64_t generation = 0;
+  uint64_t frame = 0;
+  std::unordered_map<Data const*, Packed> packed;
+};
@@ -0,0 +1,55 @@
+/*
+ * Part of Spaghetti.
+ * Copyright 2025 Dario Mambro.
+ * Distriuted under the GNU Affero General Public License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Reads the array of coordinates of value or curve data with another array length and number of coordinates, in
+// place. A dimension of size one upstream is broadcast, and elements missing upstream read as T{}.
+template<class T>
+class ValueView final {
+public:
+  ValueView() = default;
+  ValueView(std::vector<std::vector<T>> const& source, uint32_t array_length, uint32_t num_coords)
+    : source{ &source }
+    , array_length{ array_length }
+    , num_coords{ num_coords }
+    , array_stride{ source.size() == 1 ? 0u : 1u } {}
+
+  uint32_t GetArrayLength() const { return array_length; }
+  uint32_t GetNumCoords() const { return num_coords; }
+
+  T const& operator()(uint32_t array_index, uint32_t coord) const {
+    static T const missing{};
+    auto const row = GetRow(array_index);
+    if (!row || row->empty()) {
+      return missing;
+    }
+    if (row->size() == 1) {
+      return (*row)[0];
+    }
+    return coord < row->size() ? (*row)[coord] : missing;
+  }
+
+  // the coordinates of an array element, when all of them can be read in place
+  T const* GetContiguous(uint32_t array_index) const {
+    auto const row = GetRow(array_index);
+    return row && row->size() >= num_coords ? row->data() : nullptr;
+  }
+
+private:
+  std::vector<T> const* GetRow(uint32_t array_index) const {
+    auto const index = size_t(array_index) * array_stride;
+    return source && index < source->size() ? &(*source)[index] : nullptr;
+  }
+
+  std::vector<std::vector<T>> const* source = nullptr;
+  uint32_t array_length = 0;
+  uint32_t num_coords = 0;
+  uint32_t array_stride = 1; // 0 to broadcast
+};